@@ -0,0 +1,194 @@
+import beat.detector;
+import bench.common;
+import bench.signals;
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <print>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+constexpr std::array<std::uint32_t, 4> kDefaultBufferSizes {256U, 512U, 1024U, 2048U};
+
+constexpr double kToleranceSeconds = 0.070;  // the usual beat-tracking evaluation window
+constexpr double kSkipSeconds      = 5.0;    // the tracker needs a few seconds to lock on
+
+struct Options {
+    std::vector<std::uint32_t> buffer_sizes;
+    std::string_view           signal;  // run only this one, all when empty
+    double                     seconds {30.0};
+    std::uint32_t              repeat {3U};
+};
+
+struct Accuracy {
+    std::size_t detected {0U};
+    std::size_t matched {0U};
+    double      f_measure {0.0};
+};
+
+// Greedy one-to-one matching of detections to ground truth within ±kToleranceSeconds, both
+// sorted. Beats in the first kSkipSeconds are left out on both sides.
+[[nodiscard]] auto score(std::span<const double> truth, std::span<const double> detected)
+    -> Accuracy {
+    const auto settled = [](double time) { return time >= kSkipSeconds; };
+
+    std::vector<double> reference;
+    std::vector<double> estimate;
+    std::ranges::copy_if(truth, std::back_inserter(reference), settled);
+    std::ranges::copy_if(detected, std::back_inserter(estimate), settled);
+
+    Accuracy    accuracy {.detected = estimate.size()};
+    std::size_t next = 0U;
+    for (const auto beat : reference) {
+        while (next < estimate.size() && estimate[next] < beat - kToleranceSeconds) {
+            ++next;
+        }
+        if (next < estimate.size() && estimate[next] <= beat + kToleranceSeconds) {
+            ++accuracy.matched;
+            ++next;
+        }
+    }
+
+    if (!reference.empty() && !estimate.empty()) {
+        const auto matched   = static_cast<double>(accuracy.matched);
+        const auto precision = matched / static_cast<double>(estimate.size());
+        const auto recall    = matched / static_cast<double>(reference.size());
+        if (precision + recall > 0.0) {
+            accuracy.f_measure = 2.0 * precision * recall / (precision + recall);
+        }
+    }
+    return accuracy;
+}
+
+// Captures references into `options`
+[[nodiscard]] auto optionTable(Options& options) -> std::array<bench::Option, 4> {
+    return {{
+        {.flag       = "--buffer",
+         .value_name = "<frames>",
+         .help       = "Buffer size, repeatable (default: 256 512 1024 2048)",
+         .apply      = bench::appendPositive(options.buffer_sizes)},
+        {.flag       = "--signal",
+         .value_name = "<name>",
+         .help       = "Run only this signal (default: all)",
+         .apply      = bench::text(options.signal)},
+        {.flag       = "--seconds",
+         .value_name = "<s>",
+         .help       = "Length of every generated signal (default: 30)",
+         .apply      = bench::greaterThan(options.seconds, kSkipSeconds)},
+        {.flag       = "--repeat",
+         .value_name = "<n>",
+         .help       = "Timed runs per case, the fastest is kept (default: 3)",
+         .apply      = bench::positive(options.repeat)},
+    }};
+}
+
+// Prints the usage and returns nothing when the arguments are not understood
+[[nodiscard]] auto parseArgs(std::span<char*> args) -> std::optional<Options> {
+    Options    options {};
+    const auto table = optionTable(options);
+    if (!bench::parseOptions(args, table)) {
+        bench::printUsage(stdout, "beat_bench", table);
+        return std::nullopt;
+    }
+
+    if (options.buffer_sizes.empty()) {
+        options.buffer_sizes.assign(kDefaultBufferSizes.begin(), kDefaultBufferSizes.end());
+    }
+    return options;
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int {
+    const auto options = parseArgs(std::span {argv, static_cast<std::size_t>(argc)});
+    if (!options) {
+        return EXIT_FAILURE;
+    }
+
+    std::println("{:<14} {:>6} {:>12} {:>9} {:>9} {:>8} {:>7} {:>6}",
+                 "signal",
+                 "buffer",
+                 "blocks/s",
+                 "ns/sample",
+                 "realtime",
+                 "bpm err",
+                 "beats",
+                 "F");
+
+    int status = EXIT_SUCCESS;
+    for (auto spec : bench::standardSignals()) {
+        if (!options->signal.empty() && spec.name != options->signal) {
+            continue;
+        }
+
+        spec.seconds      = options->seconds;
+        const auto signal = bench::generate(spec);
+        const auto rate   = static_cast<double>(spec.sample_rate);
+
+        for (const auto buffer_size : options->buffer_sizes) {
+            const beat::OfflineOptions analysis {.buffer_size = buffer_size};
+
+            // Beats land at the sample the tracker placed them on, not the start of the block.
+            // Only the first run collects them; the timed minimum then excludes the sink.
+            std::vector<double>   beats;
+            const beat::EventSink collect = [&](const beat::Event& event) {
+                if (event.is_beat) {
+                    beats.push_back(static_cast<double>(event.frame + event.beat_offset) / rate);
+                }
+            };
+            const beat::EventSink none {};
+
+            auto                               best = std::numeric_limits<double>::infinity();
+            std::optional<beat::OfflineReport> report;
+            for (std::uint32_t run = 0U; run < options->repeat; ++run) {
+                const auto result = beat::analyzeSamples(
+                    signal.samples, spec.sample_rate, analysis, run == 0U ? collect : none);
+                if (!result) {
+                    std::println(stderr, "{} @ {}: {}", spec.name, buffer_size, result.error());
+                    status = EXIT_FAILURE;
+                    break;
+                }
+                best   = std::min(best, result->elapsed_seconds);
+                report = *result;
+            }
+            if (!report) {
+                continue;
+            }
+
+            const auto frames   = static_cast<double>(signal.samples.size());
+            const auto accuracy = score(signal.beats, beats);
+            const auto bpm_error =
+                signal.final_bpm > 0.0
+                    ? std::format("{:.2f}", std::abs(report->final_bpm - signal.final_bpm))
+                    : std::string {"-"};
+            const auto f_measure = signal.beats.empty()
+                                       ? std::string {"-"}
+                                       : std::format("{:.3f}", accuracy.f_measure);
+
+            std::println("{:<14} {:>6} {:>12.0f} {:>9.2f} {:>8.0f}x {:>8} {:>7} {:>6}",
+                         spec.name,
+                         buffer_size,
+                         frames / static_cast<double>(buffer_size) / best,
+                         best * 1e9 / frames,
+                         frames / rate / best,
+                         bpm_error,
+                         accuracy.detected,
+                         f_measure);
+        }
+    }
+
+    return status;
+}
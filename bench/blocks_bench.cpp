@@ -0,0 +1,470 @@
+import audio.blocks;
+import bench.common;
+import bench.fake_stream;
+
+#include <spa/buffer/buffer.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <print>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::array<std::size_t, 4> kBufferSizes {256U, 1024U, 4096U, 16384U};
+constexpr std::array<std::size_t, 3> kBlockSizes {64U, 256U, 512U};
+constexpr std::array<std::size_t, 2> kDownmixChannels {2U, 6U};
+constexpr std::size_t                kConvertSamples = 1024U;  // one typical quantum
+
+// Makes `value` observable to the optimizer so the work producing it cannot be dropped
+template <typename T>
+inline void keep(const T& value) noexcept {
+    asm volatile("" : : "m"(value) : "memory");
+}
+
+struct Options {
+    std::string_view filter;  // run only cases whose name contains this
+    std::string_view output;  // JSON file, stdout when empty
+    double           min_time_ms {50.0};
+    std::uint32_t    repetitions {5U};
+};
+
+struct Result {
+    std::string   name;
+    std::size_t   samples {0U};  // samples handled per iteration, 0 when not meaningful
+    std::uint64_t iterations {0U};
+    double        ns_per_iter {0.0};
+    double        raw_ns_per_iter {0.0};  // the hand-written loop doing the same work, 0 if none
+};
+
+class Runner {
+public:
+    explicit Runner(const Options& options) noexcept
+        : options_(options) {}
+
+    // Times `body` as case `name`, and `raw` as its hand-written twin when given
+    template <typename Body, typename Raw = std::nullptr_t>
+    void run(std::string name, std::size_t samples, Body&& body, Raw&& raw = nullptr) {
+        if (!options_.filter.empty() && !name.contains(options_.filter)) {
+            return;
+        }
+
+        Result result {.name = std::move(name), .samples = samples};
+        std::tie(result.ns_per_iter, result.iterations) = measure(body);
+        if constexpr (!std::is_same_v<std::remove_cvref_t<Raw>, std::nullptr_t>) {
+            result.raw_ns_per_iter = measure(raw).first;
+        }
+
+        std::println(stderr,
+                     "{:<40} {:>12.1f} ns {:>8.3f} ns/sample",
+                     result.name,
+                     result.ns_per_iter,
+                     result.samples > 0U ? result.ns_per_iter / static_cast<double>(result.samples)
+                                         : 0.0);
+        results_.push_back(std::move(result));
+    }
+
+    [[nodiscard]] auto results() const noexcept -> std::span<const Result> {
+        return results_;
+    }
+
+private:
+    // Median ns per call over the repetitions, each long enough to reach the minimum time
+    template <typename Body>
+    auto measure(Body& body) const -> std::pair<double, std::uint64_t> {
+        const auto min_time = std::chrono::duration<double, std::milli>(options_.min_time_ms);
+
+        std::uint64_t iterations = 1U;
+        for (;;) {
+            const auto elapsed = timeLoop(body, iterations);
+            if (elapsed >= min_time / 10.0 || iterations >= (std::uint64_t {1} << 40U)) {
+                const auto scale = std::max(1.0, min_time / std::max(elapsed, min_time / 1e6));
+                iterations       = static_cast<std::uint64_t>(
+                    static_cast<double>(iterations) * std::min(scale, 1e6));
+                break;
+            }
+            iterations *= 10U;
+        }
+
+        std::vector<double> samples;
+        for (std::uint32_t repetition = 0U; repetition < options_.repetitions; ++repetition) {
+            const std::chrono::duration<double, std::nano> elapsed = timeLoop(body, iterations);
+            samples.push_back(elapsed.count() / static_cast<double>(iterations));
+        }
+
+        std::ranges::nth_element(samples, samples.begin() + (samples.size() / 2U));
+        return {samples[samples.size() / 2U], iterations};
+    }
+
+    template <typename Body>
+    static auto timeLoop(Body& body, std::uint64_t iterations)
+        -> std::chrono::duration<double, std::milli> {
+        const auto start = Clock::now();
+        for (std::uint64_t iteration = 0U; iteration < iterations; ++iteration) {
+            body();
+        }
+        return Clock::now() - start;
+    }
+
+    Options             options_;
+    std::vector<Result> results_;
+};
+
+// A quiet sine: realistic values, and no NaNs or denormals in the float formats
+[[nodiscard]] auto testSignal(std::size_t count) -> std::vector<float> {
+    std::vector<float> samples(count);
+    for (std::size_t index = 0U; index < count; ++index) {
+        samples[index] = 0.5F * std::sin(static_cast<float>(index) * 0.01F);
+    }
+    return samples;
+}
+
+// `samples` encoded as `spec`, so every kernel converts plausible data
+[[nodiscard]] auto encode(std::span<const float> samples, audio_blocks::SampleSpec spec)
+    -> std::vector<std::byte> {
+    using enum audio_blocks::SampleFormat;
+
+    const auto width = spec.bytes();
+    auto       bits  = [&](float sample) -> std::uint64_t {
+        const double value = sample;
+        switch (spec.format) {
+            case S16:
+                return static_cast<std::uint16_t>(static_cast<std::int16_t>(value * 32767.0));
+            case S24:
+            case S24_32:
+                return static_cast<std::uint32_t>(static_cast<std::int32_t>(value * 8388607.0))
+                     & 0xFF'FFFFU;
+            case S32:
+                return static_cast<std::uint32_t>(static_cast<std::int32_t>(value * 2147483647.0));
+            case F32:
+                return std::bit_cast<std::uint32_t>(sample);
+            case F64:
+                return std::bit_cast<std::uint64_t>(value);
+        }
+        return 0U;
+    };
+
+    std::vector<std::byte> raw(samples.size() * width);
+    for (std::size_t index = 0U; index < samples.size(); ++index) {
+        const auto word  = bits(samples[index]);
+        auto       bytes = std::span {raw}.subspan(index * width, width);
+        for (std::size_t byte = 0U; byte < width; ++byte) {
+            bytes[byte] = static_cast<std::byte>((word >> (8U * byte)) & 0xFFU);
+        }
+        if (spec.byte_order == std::endian::big) {
+            std::ranges::reverse(bytes);
+        }
+    }
+    return raw;
+}
+
+void iterationCases(Runner& runner) {
+    for (const auto buffer_size : kBufferSizes) {
+        const auto samples = testSignal(buffer_size);
+
+        for (const auto block_size : kBlockSizes) {
+            if (block_size > buffer_size) {
+                continue;
+            }
+
+            const auto view =
+                *audio_blocks::makeBufferViewFromSpan(std::span {samples}, block_size);
+            runner.run(
+                std::format("blocks/iterate/{}/{}", buffer_size, block_size),
+                buffer_size,
+                [&] {
+                    float sum = 0.0F;
+                    for (const auto block : view.blocks()) {
+                        for (const auto sample : block) {
+                            sum += sample;
+                        }
+                    }
+                    keep(sum);
+                },
+                [&] {
+                    const float* data   = samples.data();
+                    const auto   usable = (buffer_size / block_size) * block_size;
+                    float        sum    = 0.0F;
+                    for (std::size_t offset = 0U; offset < usable; offset += block_size) {
+                        for (std::size_t index = 0U; index < block_size; ++index) {
+                            sum += data[offset + index];
+                        }
+                    }
+                    keep(sum);
+                });
+
+            // The same walk by block index, the way work is split across threads
+            runner.run(
+                std::format("blocks/index/{}/{}", buffer_size, block_size),
+                buffer_size,
+                [&] {
+                    const auto blocks = view.blocks();
+                    float      sum    = 0.0F;
+                    for (std::size_t index = 0U; index < blocks.size(); ++index) {
+                        for (const auto sample : blocks[index]) {
+                            sum += sample;
+                        }
+                    }
+                    keep(sum);
+                },
+                [&] {
+                    const float* data  = samples.data();
+                    const auto   count = buffer_size / block_size;
+                    float        sum   = 0.0F;
+                    for (std::size_t index = 0U; index < count; ++index) {
+                        for (std::size_t sample = 0U; sample < block_size; ++sample) {
+                            sum += data[(index * block_size) + sample];
+                        }
+                    }
+                    keep(sum);
+                });
+        }
+    }
+}
+
+void viewCases(Runner& runner) {
+    constexpr std::size_t kFrames = 1024U;
+
+    bench::FakeSpaBuffer mono {kFrames * sizeof(float), sizeof(float)};
+    runner.run(
+        "views/spa_mono_f32",
+        kFrames,
+        [&] {
+            auto view = audio_blocks::makeBufferViewFromSpaMonoF32(mono.get(), 256U);
+            keep(view);
+        },
+        [&] {
+            const auto& data = mono.get()->datas[0];
+            const std::span samples {static_cast<const float*>(data.data),
+                                     data.chunk->size / sizeof(float)};
+            keep(samples);
+        });
+
+    bench::FakeSpaBuffer stereo {kFrames * 2U * sizeof(float), 2U * sizeof(float)};
+    runner.run("views/spa_interleaved_f32_2ch", kFrames, [&] {
+        auto view = audio_blocks::makeInterleavedViewFromSpaF32(stereo.get(), 2U);
+        keep(view);
+    });
+
+    bench::FakeSpaBuffer s16 {kFrames * 2U * sizeof(std::int16_t), 2U * sizeof(std::int16_t)};
+    runner.run("views/spa_pcm_s16_2ch", kFrames, [&] {
+        auto view = audio_blocks::makePcmViewFromSpa(
+            s16.get(), audio_blocks::SampleSpec {.format = audio_blocks::SampleFormat::S16}, 2U);
+        keep(view);
+    });
+}
+
+void convertCases(Runner& runner) {
+    const auto         signal = testSignal(kConvertSamples);
+    std::vector<float> out(kConvertSamples);
+
+    for (const auto& format : audio_blocks::kSpaSampleFormats) {
+        const auto spec = format.spec;
+        const auto raw  = encode(signal, spec);
+        const auto name = std::format("convert/{}{}/{}",
+                                      audio_blocks::toString(spec.format),
+                                      spec.byte_order == std::endian::native ? "" : "_oe",
+                                      kConvertSamples);
+
+        const auto body = [&] {
+            audio_blocks::convert(raw, spec, out);
+            keep(out.data());
+        };
+
+        // Raw twins for the formats the live path sees most: plain copy and native S16
+        if (spec.isNativeF32()) {
+            runner.run(name, kConvertSamples, body, [&] {
+                std::memcpy(out.data(), raw.data(), raw.size());
+                keep(out.data());
+            });
+        } else if (spec == audio_blocks::SampleSpec {.format = audio_blocks::SampleFormat::S16}) {
+            runner.run(name, kConvertSamples, body, [&] {
+                for (std::size_t index = 0U; index < out.size(); ++index) {
+                    std::int16_t sample = 0;
+                    std::memcpy(&sample, raw.data() + (index * sizeof(sample)), sizeof(sample));
+                    out[index] = static_cast<float>(sample) * (1.0F / 32768.0F);
+                }
+                keep(out.data());
+            });
+        } else {
+            runner.run(name, kConvertSamples, body);
+        }
+    }
+
+    for (const auto channels : kDownmixChannels) {
+        const auto interleaved = testSignal(kConvertSamples * channels);
+        const auto weights     = audio_blocks::DownmixWeights::average(channels);
+
+        runner.run(
+            std::format("downmix/f32_{}ch/{}", channels, kConvertSamples),
+            kConvertSamples,
+            [&] {
+                audio_blocks::downmix(interleaved, weights, out);
+                keep(out.data());
+            },
+            [&] {
+                const auto gains = weights.gains();
+                for (std::size_t frame = 0U; frame < out.size(); ++frame) {
+                    float sum = 0.0F;
+                    for (std::size_t channel = 0U; channel < channels; ++channel) {
+                        sum += interleaved[(frame * channels) + channel] * gains[channel];
+                    }
+                    out[frame] = sum;
+                }
+                keep(out.data());
+            });
+    }
+
+    const audio_blocks::SampleSpec s16 {.format = audio_blocks::SampleFormat::S16};
+    const auto                     raw = encode(testSignal(kConvertSamples * 2U), s16);
+    const audio_blocks::PcmView    pcm {raw, s16, 2U};
+    const auto                     weights = audio_blocks::DownmixWeights::average(2U);
+    runner.run(std::format("convert_downmix/S16_2ch/{}", kConvertSamples), kConvertSamples, [&] {
+        audio_blocks::convertDownmix(pcm, 0U, weights, out);
+        keep(out.data());
+    });
+}
+
+[[nodiscard]] auto escape(std::string_view text) -> std::string {
+    std::string escaped;
+    for (const char character : text) {
+        if (character == '"' || character == '\\') {
+            escaped.push_back('\\');
+        }
+        escaped.push_back(character);
+    }
+    return escaped;
+}
+
+// One object per run, shaped so two files can be diffed or joined on "name"
+[[nodiscard]] auto toJson(std::span<const Result> results) -> std::string {
+#if defined(__clang__)
+    constexpr std::string_view kCompiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+    constexpr std::string_view kCompiler = "gcc " __VERSION__;
+#else
+    constexpr std::string_view kCompiler = "unknown";
+#endif
+#if defined(NDEBUG)
+    constexpr bool kAssertions = false;
+#else
+    constexpr bool kAssertions = true;
+#endif
+
+    std::string json = std::format(
+        "{{\n  \"context\": {{\"compiler\": \"{}\", \"assertions\": {}, "
+        "\"convert_kernel\": \"{}\", \"downmix_kernel\": \"{}\"}},\n  \"benchmarks\": [",
+        escape(kCompiler),
+        kAssertions,
+        audio_blocks::convertKernelName(),
+        audio_blocks::downmixKernelName());
+
+    for (std::size_t index = 0U; index < results.size(); ++index) {
+        const auto& result = results[index];
+        const auto  per_sample =
+            result.samples > 0U ? result.ns_per_iter / static_cast<double>(result.samples) : 0.0;
+
+        json += std::format("{}\n    {{\"name\": \"{}\", \"samples\": {}, \"iterations\": {}, "
+                            "\"ns_per_iter\": {:.3f}, \"ns_per_sample\": {:.4f}",
+                            index == 0U ? "" : ",",
+                            escape(result.name),
+                            result.samples,
+                            result.iterations,
+                            result.ns_per_iter,
+                            per_sample);
+        if (result.raw_ns_per_iter > 0.0) {
+            json += std::format(", \"raw_ns_per_iter\": {:.3f}, \"vs_raw\": {:.3f}",
+                                result.raw_ns_per_iter,
+                                result.ns_per_iter / result.raw_ns_per_iter);
+        }
+        json += "}";
+    }
+    json += "\n  ]\n}\n";
+    return json;
+}
+
+// Captures references into `options`
+[[nodiscard]] auto optionTable(Options& options) -> std::array<bench::Option, 4> {
+    return {{
+        {.flag       = "--filter",
+         .value_name = "<text>",
+         .help       = "Run only cases whose name contains text",
+         .apply      = bench::text(options.filter)},
+        {.flag       = "--json",
+         .value_name = "<path>",
+         .help       = "Write results to a file (default: stdout)",
+         .apply      = bench::text(options.output)},
+        {.flag       = "--min-time",
+         .value_name = "<ms>",
+         .help       = "Minimum time per repetition (default: 50)",
+         .apply      = bench::positive(options.min_time_ms)},
+        {.flag       = "--repetitions",
+         .value_name = "<n>",
+         .help       = "Repetitions per case, median kept (default: 5)",
+         .apply      = bench::positive(options.repetitions)},
+    }};
+}
+
+// Prints the usage (to stderr, stdout carries the JSON) when the arguments are not understood
+[[nodiscard]] auto parseArgs(std::span<char*> args) -> std::optional<Options> {
+    Options    options {};
+    const auto table = optionTable(options);
+    if (!bench::parseOptions(args, table)) {
+        bench::printUsage(stderr, "blocks_bench", table);
+        return std::nullopt;
+    }
+    return options;
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int {
+    const auto options = parseArgs(std::span {argv, static_cast<std::size_t>(argc)});
+    if (!options) {
+        return EXIT_FAILURE;
+    }
+
+    // Kernel selection happens on first use; keep it out of the first measurement
+    std::println(stderr,
+                 "convert kernel: {}, downmix kernel: {}",
+                 audio_blocks::convertKernelName(),
+                 audio_blocks::downmixKernelName());
+
+    Runner runner {*options};
+    iterationCases(runner);
+    viewCases(runner);
+    convertCases(runner);
+
+    const auto json = toJson(runner.results());
+    if (options->output.empty()) {
+        std::cout << json;
+        return EXIT_SUCCESS;
+    }
+
+    std::ofstream out {std::string {options->output}, std::ios::out | std::ios::trunc};
+    if (!(out << json) || !out.flush()) {
+        std::println(stderr, "{}: write failed", options->output);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+module;
+#include <time.h>
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <format>
+#include <functional>
+#include <optional>
+#include <print>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+export module bench.common;
+
+export namespace bench {
+
+constexpr std::int64_t kNanosPerSecond = 1'000'000'000;
+
+// CLOCK_MONOTONIC, the clock std::chrono::steady_clock and the PipeWire graph times run on
+[[nodiscard]] inline auto monotonicNs() noexcept -> std::int64_t {
+    timespec now {};
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+    return (static_cast<std::int64_t>(now.tv_sec) * kNanosPerSecond) + now.tv_nsec;
+}
+
+template <typename T>
+[[nodiscard]] auto parseNumber(std::string_view text) -> std::optional<T> {
+    T     value {};
+    auto* end    = text.data() + text.size();
+    auto  result = std::from_chars(text.data(), end, value);
+    if (result.ec != std::errc {} || result.ptr != end) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+// Takes an option's value, false rejects it
+using Apply = std::function<bool(std::string_view)>;
+
+// One command line option, which always takes a value
+struct Option {
+    std::string_view flag;
+    std::string_view value_name;
+    std::string_view help;
+    Apply            apply;
+};
+
+// Stores a number into `target`, rejecting anything not above `minimum`
+template <typename T>
+[[nodiscard]] auto greaterThan(T& target, T minimum) -> Apply {
+    return [&target, minimum](std::string_view text) {
+        const auto parsed = parseNumber<T>(text);
+        if (!parsed || *parsed <= minimum) {
+            return false;
+        }
+        target = *parsed;
+        return true;
+    };
+}
+
+template <typename T>
+[[nodiscard]] auto positive(T& target) -> Apply {
+    return greaterThan(target, T {});
+}
+
+// Stores a number within [minimum, maximum]
+template <typename T>
+[[nodiscard]] auto between(T& target, T minimum, T maximum) -> Apply {
+    return [&target, minimum, maximum](std::string_view text) {
+        const auto parsed = parseNumber<T>(text);
+        if (!parsed || *parsed < minimum || *parsed > maximum) {
+            return false;
+        }
+        target = *parsed;
+        return true;
+    };
+}
+
+// Appends a positive number, for repeatable options
+template <typename T>
+[[nodiscard]] auto appendPositive(std::vector<T>& target) -> Apply {
+    return [&target](std::string_view text) {
+        const auto parsed = parseNumber<T>(text);
+        if (!parsed || *parsed <= T {}) {
+            return false;
+        }
+        target.push_back(*parsed);
+        return true;
+    };
+}
+
+// The argument itself, which outlives the program's use of it
+[[nodiscard]] inline auto text(std::string_view& target) -> Apply {
+    return [&target](std::string_view value) {
+        target = value;
+        return true;
+    };
+}
+
+// Applies `args` (argv, program name first) to `options`. False on an unknown option, a missing
+// value or one that was rejected.
+[[nodiscard]] inline auto parseOptions(std::span<char*> args, std::span<const Option> options)
+    -> bool {
+    for (std::size_t index = 1U; index < args.size(); ++index) {
+        const std::string_view arg = args[index];
+
+        const Option* option = nullptr;
+        for (const auto& candidate : options) {
+            if (candidate.flag == arg) {
+                option = &candidate;
+            }
+        }
+
+        if (option == nullptr || index + 1U == args.size() || !option->apply(args[++index])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void printUsage(std::FILE*              stream,
+                       std::string_view        program,
+                       std::span<const Option> options) {
+    constexpr std::size_t kColumn = 20U;
+
+    std::println(stream, "Usage: {} [options]\n", program);
+    for (const auto& option : options) {
+        std::println(stream,
+                     "  {:<{}}{}",
+                     std::format("{} {}", option.flag, option.value_name),
+                     kColumn,
+                     option.help);
+    }
+}
+
+}  // namespace bench
@@ -0,0 +1,158 @@
+module;
+#include <pthread.h>
+#include <sched.h>
+#include <spa/buffer/buffer.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+export module bench.fake_stream;
+
+import bench.common;
+
+export namespace bench {
+
+// What PipeWire hands the process callback: one data plane, its chunk and the buffer header
+class FakeSpaBuffer {
+public:
+    FakeSpaBuffer(std::size_t byte_size, std::uint32_t stride)
+        : bytes_(byte_size) {
+        chunk_.size     = static_cast<std::uint32_t>(byte_size);
+        chunk_.stride   = static_cast<std::int32_t>(stride);
+        data_.type      = SPA_DATA_MemPtr;
+        data_.maxsize   = static_cast<std::uint32_t>(byte_size);
+        data_.data      = bytes_.data();
+        data_.chunk     = &chunk_;
+        buffer_.n_datas = 1U;
+        buffer_.datas   = &data_;
+    }
+
+    FakeSpaBuffer(const FakeSpaBuffer&)                    = delete;
+    auto operator=(const FakeSpaBuffer&) -> FakeSpaBuffer& = delete;
+    FakeSpaBuffer(FakeSpaBuffer&&)                         = delete;
+    auto operator=(FakeSpaBuffer&&) -> FakeSpaBuffer&      = delete;
+    ~FakeSpaBuffer()                                       = default;
+
+    [[nodiscard]] auto get() noexcept -> spa_buffer* {
+        return &buffer_;
+    }
+
+    [[nodiscard]] auto bytes() noexcept -> std::span<std::byte> {
+        return bytes_;
+    }
+
+private:
+    std::vector<std::byte> bytes_;
+    spa_chunk              chunk_ {};
+    spa_data               data_ {};
+    spa_buffer             buffer_ {};
+};
+
+struct DriverConfig {
+    std::uint32_t sample_rate {48000U};
+    std::uint32_t quantum {256U};       // frames per graph cycle
+    std::uint32_t delay_frames {256U};  // capture latency reported with every cycle
+    int           priority {80};        // SCHED_FIFO priority to ask for, 0 keeps SCHED_OTHER
+};
+
+// One graph cycle as the driver ran it. Times are CLOCK_MONOTONIC nanoseconds.
+struct Cycle {
+    std::int64_t scheduled_ns {0};  // when the cycle was due, reported as the graph time
+    std::int64_t woke_ns {0};       // when the driver actually handed the buffer over
+    std::int64_t delay_ns {0};
+};
+
+struct DriverRun {
+    std::vector<Cycle> cycles;
+    bool               realtime {false};  // SCHED_FIFO was granted
+    std::string        scheduling;        // what the driver thread ran with
+};
+
+}  // namespace bench
+
+namespace bench::detail {
+
+inline void sleepUntil(std::int64_t deadline_ns) noexcept {
+    const timespec deadline {.tv_sec  = static_cast<time_t>(deadline_ns / kNanosPerSecond),
+                             .tv_nsec = static_cast<long>(deadline_ns % kNanosPerSecond)};
+    while (::clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+    }
+}
+
+// SCHED_FIFO for the calling thread if the system allows it, as PipeWire's data thread gets
+// through RTKit or rlimits
+[[nodiscard]] inline auto requestRealtime(int priority, std::string& scheduling) -> bool {
+    if (priority <= 0) {
+        scheduling = "SCHED_OTHER (not requested)";
+        return false;
+    }
+
+    const sched_param param {.sched_priority = priority};
+    if (const int error = ::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &param);
+        error != 0) {
+        scheduling = std::format("SCHED_OTHER (SCHED_FIFO refused: {})", std::strerror(error));
+        return false;
+    }
+
+    scheduling = std::format("SCHED_FIFO {}", priority);
+    return true;
+}
+
+}  // namespace bench::detail
+
+export namespace bench {
+
+/*
+ * Stand-in for PipeWire's data thread. Wakes once per quantum on an absolute CLOCK_MONOTONIC
+ * schedule, copies the next quantum of mono float `samples` into a spa_buffer and calls
+ * `on_quantum(const spa_buffer*, const Cycle&)` from its own (RT if allowed) thread, the way
+ * the graph calls .process. A cycle that wakes late is not skipped: later cycles keep their
+ * schedule, so lateness shows up as jitter rather than lost audio.
+ *
+ * Blocks until every whole quantum of `samples` has been delivered.
+ */
+template <typename QuantumFn>
+[[nodiscard]] auto drive(std::span<const float> samples,
+                         const DriverConfig&    config,
+                         QuantumFn&&            on_quantum) -> DriverRun {
+    const auto quanta    = samples.size() / config.quantum;
+    const auto period_ns = static_cast<std::int64_t>(config.quantum) * kNanosPerSecond
+                         / static_cast<std::int64_t>(config.sample_rate);
+    const auto delay_ns  = static_cast<std::int64_t>(config.delay_frames) * kNanosPerSecond
+                         / static_cast<std::int64_t>(config.sample_rate);
+
+    DriverRun     run {.cycles = std::vector<Cycle>(quanta)};
+    FakeSpaBuffer buffer {config.quantum * sizeof(float), sizeof(float)};
+
+    std::thread driver {[&] {
+        run.realtime = detail::requestRealtime(config.priority, run.scheduling);
+
+        auto due_ns = monotonicNs() + period_ns;
+        for (std::size_t quantum = 0U; quantum < quanta; ++quantum, due_ns += period_ns) {
+            detail::sleepUntil(due_ns);
+
+            auto& cycle        = run.cycles[quantum];
+            cycle.scheduled_ns = due_ns;
+            cycle.woke_ns      = monotonicNs();
+            cycle.delay_ns     = delay_ns;
+
+            const auto source = samples.subspan(quantum * config.quantum, config.quantum);
+            std::memcpy(buffer.bytes().data(), source.data(), source.size_bytes());
+            on_quantum(static_cast<const spa_buffer*>(buffer.get()), cycle);
+        }
+    }};
+    driver.join();
+
+    return run;
+}
+
+}  // namespace bench
@@ -0,0 +1,317 @@
+import beat.detector;
+import bench.common;
+import bench.fake_stream;
+import bench.signals;
+import support.latency;
+
+#include <spa/buffer/buffer.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <print>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    bench::DriverConfig driver {};
+    std::uint32_t       buffer_size {512U};  // analysis block
+    double              seconds {20.0};
+    double              bpm {120.0};
+    std::string_view    json;  // also write the results here when set
+};
+
+// A drained event and when the consumer got hold of it
+struct Received {
+    beat::Event  event;
+    std::int64_t drained_ns;
+};
+
+/*
+ * Mainloop stand-in: sleeps until the processor's wake hook fires, then drains its rings the
+ * way StreamState::drain() does. The wakeup is a futex rather than an eventfd, a comparable
+ * cost on the RT side.
+ */
+class Consumer {
+public:
+    Consumer(beat::QuantumProcessor& processor, std::size_t capacity)
+        : processor_(processor) {
+        received_.reserve(capacity);
+        processor_.setWake(&Consumer::wake, &wakeups_);
+        thread_ = std::thread {[this] { loop(); }};
+    }
+
+    Consumer(const Consumer&)                    = delete;
+    auto operator=(const Consumer&) -> Consumer& = delete;
+    Consumer(Consumer&&)                         = delete;
+    auto operator=(Consumer&&) -> Consumer&      = delete;
+
+    ~Consumer() {
+        if (thread_.joinable()) {
+            stop();
+        }
+    }
+
+    // Drains what is left and joins
+    void stop() {
+        done_.store(true, std::memory_order_release);
+        wake(&wakeups_);
+        thread_.join();
+    }
+
+    [[nodiscard]] auto received() const noexcept -> std::span<const Received> {
+        return received_;
+    }
+
+private:
+    static void wake(void* context) noexcept {
+        auto* wakeups = static_cast<std::atomic<std::uint32_t>*>(context);
+        wakeups->fetch_add(1U, std::memory_order_release);
+        wakeups->notify_one();
+    }
+
+    void loop() {
+        std::uint32_t seen = 0U;
+        for (;;) {
+            wakeups_.wait(seen, std::memory_order_acquire);
+            seen = wakeups_.load(std::memory_order_acquire);
+
+            const bool last       = done_.load(std::memory_order_acquire);
+            const auto drained_ns = bench::monotonicNs();
+            while (const auto event = processor_.events().tryPop()) {
+                received_.push_back(Received {.event = *event, .drained_ns = drained_ns});
+            }
+            while (processor_.diagnostics().tryPop()) {
+            }
+
+            if (last) {
+                return;
+            }
+        }
+    }
+
+    beat::QuantumProcessor&    processor_;
+    std::atomic<std::uint32_t> wakeups_ {0U};
+    std::atomic_bool           done_ {false};
+    std::vector<Received>      received_;
+    std::thread                thread_;
+};
+
+struct Distribution {
+    latency::Histogram histogram;
+    double             sum {0.0};
+    double             sum_squares {0.0};
+
+    void record(std::int64_t value_ns) noexcept {
+        const auto value = static_cast<double>(std::max<std::int64_t>(value_ns, 0));
+        histogram.record(static_cast<std::uint64_t>(value));
+        sum         += value;
+        sum_squares += value * value;
+    }
+
+    [[nodiscard]] auto stddev() const noexcept -> double {
+        const auto count = static_cast<double>(histogram.count());
+        if (count < 2.0) {
+            return 0.0;
+        }
+        const auto mean = sum / count;
+        return std::sqrt(std::max(0.0, (sum_squares / count) - (mean * mean)));
+    }
+};
+
+[[nodiscard]] auto toMs(double nanoseconds) noexcept -> double {
+    return nanoseconds / 1e6;
+}
+
+[[nodiscard]] auto summary(std::string_view name, const Distribution& values) -> std::string {
+    const auto& histogram = values.histogram;
+    return std::format("{:<22} p50 {:>7.3f}  p90 {:>7.3f}  p99 {:>7.3f}  max {:>7.3f}  "
+                       "mean {:>7.3f}  stddev {:>6.3f} ms  ({} samples)",
+                       name,
+                       toMs(static_cast<double>(histogram.percentile(0.50))),
+                       toMs(static_cast<double>(histogram.percentile(0.90))),
+                       toMs(static_cast<double>(histogram.percentile(0.99))),
+                       toMs(static_cast<double>(histogram.max())),
+                       toMs(histogram.mean()),
+                       toMs(values.stddev()),
+                       histogram.count());
+}
+
+[[nodiscard]] auto jsonEntry(std::string_view name, const Distribution& values) -> std::string {
+    const auto& histogram = values.histogram;
+    return std::format("\"{}\": {{\"count\": {}, \"p50_ns\": {}, \"p90_ns\": {}, \"p99_ns\": {}, "
+                       "\"max_ns\": {}, \"mean_ns\": {:.0f}, \"stddev_ns\": {:.0f}}}",
+                       name,
+                       histogram.count(),
+                       histogram.percentile(0.50),
+                       histogram.percentile(0.90),
+                       histogram.percentile(0.99),
+                       histogram.max(),
+                       histogram.mean(),
+                       values.stddev());
+}
+
+// Captures references into `options`
+[[nodiscard]] auto optionTable(Options& options) -> std::array<bench::Option, 7> {
+    return {{
+        {.flag       = "--quantum",
+         .value_name = "<frames>",
+         .help       = "Frames per simulated graph cycle (default: 256)",
+         .apply      = bench::positive(options.driver.quantum)},
+        {.flag       = "--rate",
+         .value_name = "<hz>",
+         .help       = "Simulated graph rate (default: 48000)",
+         .apply      = bench::positive(options.driver.sample_rate)},
+        {.flag       = "--buffer",
+         .value_name = "<frames>",
+         .help       = "Analysis block size (default: 512)",
+         .apply      = bench::positive(options.buffer_size)},
+        {.flag       = "--priority",
+         .value_name = "<n>",
+         .help       = "SCHED_FIFO priority of the driver, 0 = none (default: 80)",
+         .apply      = bench::between(options.driver.priority, 0, 99)},
+        {.flag       = "--seconds",
+         .value_name = "<s>",
+         .help       = "Length of the run (default: 20)",
+         .apply      = bench::positive(options.seconds)},
+        {.flag       = "--bpm",
+         .value_name = "<bpm>",
+         .help       = "Tempo of the click track fed in (default: 120)",
+         .apply      = bench::positive(options.bpm)},
+        {.flag       = "--json",
+         .value_name = "<path>",
+         .help       = "Also write the results as JSON",
+         .apply      = bench::text(options.json)},
+    }};
+}
+
+// Prints the usage and returns nothing when the arguments are not understood
+[[nodiscard]] auto parseArgs(std::span<char*> args) -> std::optional<Options> {
+    Options    options {};
+    const auto table = optionTable(options);
+    if (!bench::parseOptions(args, table)) {
+        bench::printUsage(stdout, "latency_bench", table);
+        return std::nullopt;
+    }
+
+    options.driver.delay_frames = options.driver.quantum;  // one period of capture latency
+    return options;
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int {
+    const auto options = parseArgs(std::span {argv, static_cast<std::size_t>(argc)});
+    if (!options) {
+        return EXIT_FAILURE;
+    }
+
+    const auto& driver = options->driver;
+    const auto  signal = bench::generate(bench::SignalSpec {.name        = "clicks",
+                                                            .bpm         = options->bpm,
+                                                            .seconds     = options->seconds,
+                                                            .sample_rate = driver.sample_rate});
+
+    // Large (two rings), so not on the stack
+    auto processor = std::make_unique<beat::QuantumProcessor>(
+        beat::QuantumConfig {.buffer_size   = options->buffer_size,
+                             .fft_size      = options->buffer_size * 2U,
+                             .stats_enabled = true});
+    if (auto started = processor->start(driver.sample_rate); !started) {
+        std::println(stderr, "cannot analyze at {} Hz: {}", driver.sample_rate, started.error());
+        return EXIT_FAILURE;
+    }
+
+    Consumer   consumer {*processor, signal.beats.size() * 4U};
+    const auto run = bench::drive(signal.samples,
+                                  driver,
+                                  [&](const spa_buffer* buffer, const bench::Cycle& cycle) {
+                                      processor->process(
+                                          buffer,
+                                          beat::GraphTime {.now_ns   = cycle.scheduled_ns,
+                                                           .delay_ns = cycle.delay_ns});
+                                  });
+    consumer.stop();
+
+    // Input: the wakeup that handed the beat's sample over, nothing could have seen it sooner
+    Distribution input_to_event;
+    Distribution capture_to_event;  // from the sample's own graph time, capture delay included
+    Distribution wake_lateness;     // driver wakeups against their schedule
+
+    for (const auto& cycle : run.cycles) {
+        wake_lateness.record(cycle.woke_ns - cycle.scheduled_ns);
+    }
+
+    std::size_t beats = 0U;
+    for (const auto& [event, drained_ns] : consumer.received()) {
+        if (!event.is_beat) {
+            continue;
+        }
+        ++beats;
+
+        const auto cycle = (event.frame + event.beat_offset) / driver.quantum;
+        if (cycle < run.cycles.size()) {
+            input_to_event.record(drained_ns - run.cycles[cycle].woke_ns);
+        }
+        capture_to_event.record(drained_ns - static_cast<std::int64_t>(event.timestamp_ns));
+    }
+
+    const auto health = processor->healthSnapshot();
+    std::println("driver: {} quanta of {} frames at {} Hz, {}",
+                 run.cycles.size(),
+                 driver.quantum,
+                 driver.sample_rate,
+                 run.scheduling);
+    std::println("analysis: {} frame blocks, {} beats detected of {} played",
+                 options->buffer_size,
+                 beats,
+                 signal.beats.size());
+    std::println("health: {} xruns, {} late callbacks, {} overruns, {} dropped, "
+                 "dsp load max {:.1f}%",
+                 health.xruns,
+                 health.late_callbacks,
+                 health.overruns,
+                 health.dropped_events,
+                 100.0 * static_cast<double>(health.dsp_load_max));
+    std::println("{}", summary("input -> event", input_to_event));
+    std::println("{}", summary("capture -> event", capture_to_event));
+    std::println("{}", summary("driver wake lateness", wake_lateness));
+
+    if (!options->json.empty()) {
+        std::ofstream out {std::string {options->json}, std::ios::out | std::ios::trunc};
+        out << std::format("{{\"quantum\": {}, \"rate\": {}, \"buffer\": {}, \"realtime\": {}, "
+                           "\"beats\": {}, \"xruns\": {}, \"late_callbacks\": {}, "
+                           "\"overruns\": {}, {}, {}, {}}}\n",
+                           driver.quantum,
+                           driver.sample_rate,
+                           options->buffer_size,
+                           run.realtime,
+                           beats,
+                           health.xruns,
+                           health.late_callbacks,
+                           health.overruns,
+                           jsonEntry("input_to_event", input_to_event),
+                           jsonEntry("capture_to_event", capture_to_event),
+                           jsonEntry("wake_lateness", wake_lateness));
+        if (!out.flush()) {
+            std::println(stderr, "{}: write failed", options->json);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return beats > 0U ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,156 @@
+module;
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <span>
+#include <string_view>
+#include <vector>
+
+export module bench.signals;
+
+export namespace bench {
+
+enum class SignalKind : std::uint8_t {
+    ClickTrack,   // one click per beat, accented downbeats
+    Swing,        // beats plus a weaker, late off-beat
+    TempoRamp,    // click track whose tempo glides from `bpm` to `end_bpm`
+    NoisyClicks,  // click track under white noise
+    Noise,        // white noise only, no beats
+    Silence,
+};
+
+struct SignalSpec {
+    std::string_view name;
+    SignalKind       kind {SignalKind::ClickTrack};
+    double           bpm {120.0};
+    double           end_bpm {120.0};  // TempoRamp
+    double           swing {0.0};      // Swing: off-beat delay as a fraction of half a beat
+    double           noise {0.0};      // peak amplitude of the white noise, NoisyClicks/Noise
+    double           seconds {30.0};
+    std::uint32_t    sample_rate {48000U};
+    std::uint64_t    seed {1U};
+};
+
+struct Signal {
+    std::vector<float>  samples;
+    std::vector<double> beats;  // ground truth beat times in seconds
+    double              final_bpm {0.0};  // tempo at the end of the signal, 0 without beats
+};
+
+}  // namespace bench
+
+namespace bench::detail {
+
+// xorshift64*: deterministic across platforms and standard libraries, unlike <random>
+class Noise {
+public:
+    explicit Noise(std::uint64_t seed) noexcept
+        : state_(seed != 0U ? seed : 0x9E37'79B9'7F4A'7C15U) {}
+
+    // Uniform in [-1, 1)
+    auto next() noexcept -> float {
+        state_ ^= state_ >> 12U;
+        state_ ^= state_ << 25U;
+        state_ ^= state_ >> 27U;
+        const auto bits = (state_ * 0x2545'F491'4F6C'DD1DU) >> 40U;  // 24 bits
+        return (static_cast<float>(bits) / static_cast<float>(1U << 23U)) - 1.0F;
+    }
+
+private:
+    std::uint64_t state_;
+};
+
+constexpr double kClickSeconds = 0.030;
+
+// Adds a click at `start`: a noise burst for the onset detectors and a low thump for the
+// tempo tracker, both decaying within a few milliseconds
+inline void addClick(std::span<float> out,
+                     std::size_t      start,
+                     float            gain,
+                     std::uint32_t    sample_rate,
+                     Noise&           noise) {
+    const auto rate   = static_cast<double>(sample_rate);
+    const auto length = std::min(out.size() - std::min(out.size(), start),
+                                 static_cast<std::size_t>(kClickSeconds * rate));
+
+    for (std::size_t index = 0U; index < length; ++index) {
+        const auto time  = static_cast<double>(index) / rate;
+        const auto burst = static_cast<double>(noise.next()) * std::exp(-time / 0.002);
+        const auto thump = std::sin(2.0 * std::numbers::pi * 80.0 * time) * std::exp(-time / 0.010);
+        out[start + index] += gain * static_cast<float>((0.6 * burst) + (0.4 * thump));
+    }
+}
+
+}  // namespace bench::detail
+
+export namespace bench {
+
+// Renders `spec` deterministically: the same spec always gives the same samples
+[[nodiscard]] inline auto generate(const SignalSpec& spec) -> Signal {
+    const auto rate   = static_cast<double>(spec.sample_rate);
+    const auto frames = static_cast<std::size_t>(spec.seconds * rate);
+
+    Signal        signal {.samples = std::vector<float>(frames, 0.0F), .beats = {}};
+    detail::Noise noise {spec.seed};
+
+    const bool has_beats = spec.kind != SignalKind::Noise && spec.kind != SignalKind::Silence;
+    if (has_beats) {
+        const auto end_bpm = spec.kind == SignalKind::TempoRamp ? spec.end_bpm : spec.bpm;
+        const auto off_beat =
+            spec.kind == SignalKind::Swing ? 0.5 + (0.5 * spec.swing) : 2.0;  // 2: never
+
+        // Integrate the tempo sample by sample so ramps land exactly where the phase says
+        double      phase      = 0.0;
+        std::size_t beat_index = 0U;
+        bool        off_done   = false;
+        for (std::size_t frame = 0U; frame < frames; ++frame) {
+            const auto progress = static_cast<double>(frame) / static_cast<double>(frames);
+            const auto bpm      = spec.bpm + ((end_bpm - spec.bpm) * progress);
+
+            if (phase >= static_cast<double>(beat_index)) {
+                const float gain = beat_index % 4U == 0U ? 1.0F : 0.7F;
+                detail::addClick(signal.samples, frame, gain, spec.sample_rate, noise);
+                signal.beats.push_back(static_cast<double>(frame) / rate);
+                ++beat_index;
+                off_done = false;
+            } else if (!off_done && phase - static_cast<double>(beat_index - 1U) >= off_beat) {
+                detail::addClick(signal.samples, frame, 0.35F, spec.sample_rate, noise);
+                off_done = true;
+            }
+
+            phase += bpm / (60.0 * rate);
+        }
+        signal.final_bpm = end_bpm;
+    }
+
+    if (spec.noise > 0.0 && spec.kind != SignalKind::Silence) {
+        const auto amplitude = static_cast<float>(spec.noise);
+        for (auto& sample : signal.samples) {
+            sample += amplitude * noise.next();
+        }
+    }
+
+    return signal;
+}
+
+// The suite the benchmark runs by default
+[[nodiscard]] inline auto standardSignals() noexcept -> std::span<const SignalSpec> {
+    using enum SignalKind;
+
+    static constexpr std::array kSignals {
+        SignalSpec {.name = "clicks-90", .kind = ClickTrack, .bpm = 90.0},
+        SignalSpec {.name = "clicks-120", .kind = ClickTrack, .bpm = 120.0},
+        SignalSpec {.name = "clicks-174", .kind = ClickTrack, .bpm = 174.0},
+        SignalSpec {.name = "swing-100", .kind = Swing, .bpm = 100.0, .swing = 0.33},
+        SignalSpec {.name = "ramp-100-140", .kind = TempoRamp, .bpm = 100.0, .end_bpm = 140.0},
+        SignalSpec {.name = "noisy-128", .kind = NoisyClicks, .bpm = 128.0, .noise = 0.1},
+        SignalSpec {.name = "noise", .kind = Noise, .noise = 0.3},
+        SignalSpec {.name = "silence", .kind = Silence},
+    };
+    return kSignals;
+}
+
+}  // namespace bench
@@ -0,0 +1,118 @@
+module;
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+export module audio.blocks:accumulator;
+
+import :core;
+
+export namespace audio_blocks {
+
+/// Fixed-capacity sample FIFO that stitches partial blocks across successive buffers.
+///
+/// Every sample pushed is handed to the block callback exactly once, in order, in blocks of
+/// exactly `blockSize()` samples. Whole blocks are passed straight from the caller's memory;
+/// only the leftover tail is copied into the preallocated pending block, so `push()` never
+/// allocates and is safe to call from a real-time thread.
+template <typename Sample>
+    requires(std::is_trivially_copyable_v<Sample>)
+class BlockAccumulator {
+public:
+    using SampleType = Sample;
+
+    BlockAccumulator() = default;
+
+    // Allocates the pending block up front, call this outside of the real-time thread
+    explicit BlockAccumulator(std::size_t block_size_samples)
+        : pending_(block_size_samples) {}
+
+    [[nodiscard]] auto blockSize() const noexcept -> std::size_t {
+        return pending_.size();
+    }
+
+    // Samples carried over from previous pushes, always < blockSize()
+    [[nodiscard]] auto pendingSize() const noexcept -> std::size_t {
+        return fill_;
+    }
+
+    void reset() noexcept {
+        fill_ = 0U;
+    }
+
+    template <typename BlockFn>
+        requires std::invocable<BlockFn&, std::span<const SampleType>>
+    void push(std::span<const SampleType> input, BlockFn&& on_block) noexcept(
+        std::is_nothrow_invocable_v<BlockFn&, std::span<const SampleType>>) {
+        const auto block_size = pending_.size();
+        if (block_size == 0U || input.empty()) {
+            return;
+        }
+
+        const std::span<SampleType> pending {pending_};
+
+        // Complete the block left over from the previous push first
+        if (fill_ != 0U) {
+            const auto take = std::min(block_size - fill_, input.size());
+            std::ranges::copy(input.first(take), pending.subspan(fill_).begin());
+            fill_ += take;
+            input  = input.subspan(take);
+
+            if (fill_ < block_size) {
+                return;
+            }
+
+            on_block(std::span<const SampleType> {pending});
+            fill_ = 0U;
+        }
+
+        const BufferView<SampleType> view {input, block_size};
+        for (auto block : view.blocks()) {
+            on_block(block);
+        }
+
+        const auto tail = view.tailPartial();
+        std::ranges::copy(tail, pending.begin());
+        fill_ = tail.size();
+    }
+
+    /// Like push(), for input that has to be produced on the way in (converted, downmixed).
+    ///
+    /// `produce(destination, first)` writes input samples [first, first + destination.size())
+    /// into `destination`, which is always a region of the pending block, so every block is
+    /// assembled in place in the same preallocated buffer and handed over without another copy.
+    template <typename ProduceFn, typename BlockFn>
+        requires std::invocable<ProduceFn&, std::span<SampleType>, std::size_t>
+                 && std::invocable<BlockFn&, std::span<const SampleType>>
+    void fill(std::size_t count, ProduceFn&& produce, BlockFn&& on_block) noexcept(
+        std::is_nothrow_invocable_v<ProduceFn&, std::span<SampleType>, std::size_t>
+        && std::is_nothrow_invocable_v<BlockFn&, std::span<const SampleType>>) {
+        const auto block_size = pending_.size();
+        if (block_size == 0U) {
+            return;
+        }
+
+        const std::span<SampleType> pending {pending_};
+
+        for (std::size_t first = 0U; first < count;) {
+            const auto take = std::min(block_size - fill_, count - first);
+            produce(pending.subspan(fill_, take), first);
+            fill_ += take;
+            first += take;
+
+            if (fill_ == block_size) {
+                on_block(std::span<const SampleType> {pending});
+                fill_ = 0U;
+            }
+        }
+    }
+
+private:
+    std::vector<SampleType> pending_ {};
+    std::size_t             fill_ {0U};
+};
+
+}  // namespace audio_blocks
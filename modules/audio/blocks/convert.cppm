@@ -0,0 +1,584 @@
+module;
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <span>
+#include <string_view>
+
+export module audio.blocks:convert;
+
+import :core;
+import :downmix;
+
+export namespace audio_blocks {
+
+using namespace std::string_view_literals;
+
+/// Raw PCM sample formats. S24 is packed into three bytes, S24_32 sits in the low 24 bits of a
+/// 32-bit container.
+enum class SampleFormat : std::uint8_t {
+    S16,
+    S24,
+    S24_32,
+    S32,
+    F32,
+    F64,
+};
+
+inline constexpr std::size_t kSampleFormatCount = 6U;
+
+[[nodiscard]] constexpr auto toString(SampleFormat format) noexcept -> std::string_view {
+    switch (format) {
+        using enum SampleFormat;
+        // clang-format off
+        case S16:    return "S16"sv;
+        case S24:    return "S24"sv;
+        case S24_32: return "S24_32"sv;
+        case S32:    return "S32"sv;
+        case F32:    return "F32"sv;
+        case F64:    return "F64"sv;
+        default:     return "unknown"sv;
+        // clang-format on
+    }
+}
+
+[[nodiscard]] constexpr auto bytesPerSample(SampleFormat format) noexcept -> std::size_t {
+    switch (format) {
+        using enum SampleFormat;
+        // clang-format off
+        case S16:    return 2U;
+        case S24:    return 3U;
+        case S24_32: return 4U;
+        case S32:    return 4U;
+        case F32:    return 4U;
+        case F64:    return 8U;
+        default:     return 0U;
+        // clang-format on
+    }
+}
+
+struct SampleSpec {
+    SampleFormat format {SampleFormat::F32};
+    std::endian  byte_order {std::endian::native};
+
+    [[nodiscard]] constexpr auto bytes() const noexcept -> std::size_t {
+        return bytesPerSample(format);
+    }
+
+    // Floats in host order: usable as they are, no conversion
+    [[nodiscard]] constexpr auto isNativeF32() const noexcept -> bool {
+        return format == SampleFormat::F32 && byte_order == std::endian::native;
+    }
+
+    friend constexpr auto operator==(const SampleSpec&, const SampleSpec&) -> bool = default;
+};
+
+/// Interleaved raw PCM frames of any SampleSpec.
+class PcmView {
+public:
+    constexpr PcmView() = default;
+
+    constexpr PcmView(std::span<const std::byte> bytes,
+                      SampleSpec                 spec,
+                      std::size_t                channels) noexcept
+        : bytes_(bytes)
+        , spec_(spec)
+        , channels_(channels) {}
+
+    [[nodiscard]] constexpr auto bytes() const noexcept -> std::span<const std::byte> {
+        return bytes_;
+    }
+
+    [[nodiscard]] constexpr auto spec() const noexcept -> SampleSpec {
+        return spec_;
+    }
+
+    [[nodiscard]] constexpr auto channels() const noexcept -> std::size_t {
+        return channels_;
+    }
+
+    [[nodiscard]] constexpr auto frameSize() const noexcept -> std::size_t {
+        return spec_.bytes() * channels_;
+    }
+
+    [[nodiscard]] constexpr auto frames() const noexcept -> std::size_t {
+        return bytes_.size() / frameSize();
+    }
+
+    [[nodiscard]] constexpr auto empty() const noexcept -> bool {
+        return bytes_.empty();
+    }
+
+    // Bytes of frames [first_frame, first_frame + frame_count)
+    [[nodiscard]] constexpr auto frameSpan(std::size_t first_frame,
+                                           std::size_t frame_count) const noexcept
+        -> std::span<const std::byte> {
+        return bytes_.subspan(first_frame * frameSize(), frame_count * frameSize());
+    }
+
+    // The samples viewed as floats in place, empty unless they are aligned native F32
+    [[nodiscard]] auto asF32() const noexcept -> std::span<const float> {
+        if (!spec_.isNativeF32()
+            || reinterpret_cast<std::uintptr_t>(bytes_.data()) % alignof(float) != 0U) {
+            return {};
+        }
+
+        return {reinterpret_cast<const float*>(bytes_.data()), bytes_.size() / sizeof(float)};
+    }
+
+private:
+    std::span<const std::byte> bytes_ {};
+    SampleSpec                 spec_ {};
+    std::size_t                channels_ {1U};
+};
+
+[[nodiscard]] inline auto makePcmViewFromBytes(const void* data,
+                                               std::size_t byte_size,
+                                               SampleSpec  spec,
+                                               std::size_t channels) noexcept
+    -> std::expected<PcmView, ViewError> {
+    using enum ViewError;
+
+    if (data == nullptr) {
+        return std::unexpected {NullData};
+    }
+
+    if (channels == 0U) {
+        return std::unexpected {ZeroChannels};
+    }
+
+    // Only whole frames
+    if (byte_size % (spec.bytes() * channels)) {
+        return std::unexpected {MisalignedBytes};
+    }
+
+    return PcmView {std::span {static_cast<const std::byte*>(data), byte_size}, spec, channels};
+}
+
+}  // namespace audio_blocks
+
+namespace audio_blocks::detail {
+
+using ConvertFn = void (*)(std::span<const std::byte>, std::span<float>);
+
+static_assert(std::endian::native == std::endian::little
+              || std::endian::native == std::endian::big);
+
+inline constexpr std::endian kForeignEndian =
+    std::endian::native == std::endian::little ? std::endian::big : std::endian::little;
+
+inline constexpr float kScale16 = 1.0F / 32768.0F;
+inline constexpr float kScale24 = 1.0F / 8388608.0F;
+inline constexpr float kScale32 = 1.0F / 2147483648.0F;
+
+template <typename Word, std::endian kOrder>
+[[nodiscard]] inline auto loadWord(std::span<const std::byte> bytes) noexcept -> Word {
+    Word word {};
+    std::memcpy(&word, bytes.data(), sizeof(Word));
+    if constexpr (kOrder != std::endian::native) {
+        word = std::byteswap(word);
+    }
+    return word;
+}
+
+// One sample to a float in [-1, 1)
+template <SampleFormat kFormat, std::endian kOrder>
+[[nodiscard]] inline auto decodeSample(std::span<const std::byte> bytes) noexcept -> float {
+    using enum SampleFormat;
+
+    if constexpr (kFormat == S16) {
+        const auto raw = loadWord<std::uint16_t, kOrder>(bytes);
+        return static_cast<float>(std::bit_cast<std::int16_t>(raw)) * kScale16;
+    } else if constexpr (kFormat == S24) {
+        const auto byte = [bytes](std::size_t index) {
+            return std::to_integer<std::uint32_t>(bytes[index]);
+        };
+        const std::uint32_t raw = kOrder == std::endian::little
+                                    ? byte(0U) | (byte(1U) << 8U) | (byte(2U) << 16U)
+                                    : byte(2U) | (byte(1U) << 8U) | (byte(0U) << 16U);
+        // Shift into the top of an int32 so the sign bit lands in place
+        return static_cast<float>(std::bit_cast<std::int32_t>(raw << 8U) >> 8) * kScale24;
+    } else if constexpr (kFormat == S24_32) {
+        const auto raw = loadWord<std::uint32_t, kOrder>(bytes);
+        return static_cast<float>(std::bit_cast<std::int32_t>(raw << 8U) >> 8) * kScale24;
+    } else if constexpr (kFormat == S32) {
+        const auto raw = loadWord<std::uint32_t, kOrder>(bytes);
+        return static_cast<float>(std::bit_cast<std::int32_t>(raw)) * kScale32;
+    } else if constexpr (kFormat == F32) {
+        return std::bit_cast<float>(loadWord<std::uint32_t, kOrder>(bytes));
+    } else {
+        return static_cast<float>(std::bit_cast<double>(loadWord<std::uint64_t, kOrder>(bytes)));
+    }
+}
+
+// Reference kernel, also finishes the samples the vector kernels leave over
+template <SampleFormat kFormat, std::endian kOrder>
+inline void convertScalar(std::span<const std::byte> raw, std::span<float> out) noexcept {
+    constexpr auto kBytes = bytesPerSample(kFormat);
+
+    if constexpr (kFormat == SampleFormat::F32 && kOrder == std::endian::native) {
+        std::memcpy(out.data(), raw.data(), out.size() * sizeof(float));
+    } else {
+        for (std::size_t index = 0U; index < out.size(); ++index) {
+            out[index] = decodeSample<kFormat, kOrder>(raw.subspan(index * kBytes, kBytes));
+        }
+    }
+}
+
+// Samples [done, out.size()) through the scalar kernel
+template <SampleFormat kFormat, std::endian kOrder>
+inline void convertTail(std::span<const std::byte> raw,
+                        std::span<float>           out,
+                        std::size_t                done) noexcept {
+    convertScalar<kFormat, kOrder>(raw.subspan(done * bytesPerSample(kFormat)), out.subspan(done));
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// x86 is little-endian: big-endian data is the byte-swapped case below
+
+// Unaligned 128-bit load, any vector type
+template <typename Vector>
+[[nodiscard]] inline auto loadBytes(std::span<const std::byte> raw, std::size_t offset) noexcept
+    -> Vector {
+    Vector vector;
+    std::memcpy(&vector, &raw[offset], sizeof(Vector));
+    return vector;
+}
+
+// SSE2 is part of the x86-64 baseline
+inline void convertS16Sse2(std::span<const std::byte> raw, std::span<float> out) noexcept {
+    const __m128 scale = _mm_set1_ps(kScale16);
+
+    std::size_t index = 0U;
+    for (; index + 8U <= out.size(); index += 8U) {
+        const auto samples = loadBytes<__m128i>(raw, index * 2U);
+        // Each sample lands in the top half of a 32-bit lane, the shift sign-extends it
+        const __m128i low  = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+        const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+        _mm_storeu_ps(&out[index], _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+        _mm_storeu_ps(&out[index + 4U], _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+    }
+
+    convertTail<SampleFormat::S16, std::endian::little>(raw, out, index);
+}
+
+// S32, and S24_32 shifted up by 8 so its sign bit becomes the lane's (same scale as S32 then)
+template <SampleFormat kFormat>
+inline void convertS32Sse2(std::span<const std::byte> raw, std::span<float> out) noexcept {
+    const __m128 scale = _mm_set1_ps(kScale32);
+
+    std::size_t index = 0U;
+    for (; index + 4U <= out.size(); index += 4U) {
+        auto samples = loadBytes<__m128i>(raw, index * 4U);
+        if constexpr (kFormat == SampleFormat::S24_32) {
+            samples = _mm_slli_epi32(samples, 8);
+        }
+        _mm_storeu_ps(&out[index], _mm_mul_ps(_mm_cvtepi32_ps(samples), scale));
+    }
+
+    convertTail<kFormat, std::endian::little>(raw, out, index);
+}
+
+inline void convertF64Sse2(std::span<const std::byte> raw, std::span<float> out) noexcept {
+    std::size_t index = 0U;
+    for (; index + 4U <= out.size(); index += 4U) {
+        const __m128 low  = _mm_cvtpd_ps(loadBytes<__m128d>(raw, index * 8U));
+        const __m128 high = _mm_cvtpd_ps(loadBytes<__m128d>(raw, (index * 8U) + 16U));
+        _mm_storeu_ps(&out[index], _mm_movelh_ps(low, high));
+    }
+
+    convertTail<SampleFormat::F64, std::endian::little>(raw, out, index);
+}
+
+__attribute__((target("avx2"))) inline auto load256(std::span<const std::byte> raw,
+                                                     std::size_t offset) noexcept -> __m256i {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&raw[offset]));
+}
+
+// Per 128-bit lane byte shuffles reversing 2/4/8-byte words
+__attribute__((target("avx2"))) inline auto swapMask(std::size_t word) noexcept -> __m256i {
+    const __m128i mask =
+        word == 2U   ? _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+        : word == 4U ? _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+                     : _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    return _mm256_broadcastsi128_si256(mask);
+}
+
+template <std::endian kOrder>
+__attribute__((target("avx2"))) inline void
+convertS16Avx2(std::span<const std::byte> raw, std::span<float> out) noexcept {
+    const __m256  scale = _mm256_set1_ps(kScale16);
+    const __m128i swap  = _mm256_castsi256_si128(swapMask(2U));
+
+    std::size_t index = 0U;
+    for (; index + 8U <= out.size(); index += 8U) {
+        auto samples = loadBytes<__m128i>(raw, index * 2U);
+        if constexpr (kOrder == std::endian::big) {
+            samples = _mm_shuffle_epi8(samples, swap);
+        }
+        const __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(samples));
+        _mm256_storeu_ps(&out[index], _mm256_mul_ps(values, scale));
+    }
+
+    convertTail<SampleFormat::S16, kOrder>(raw, out, index);
+}
+
+// Packed 24-bit: four samples per 12 bytes of each lane, moved into the top three bytes of
+// 32-bit lanes (the low byte zeroed) so they convert with the S32 scale
+template <std::endian kOrder>
+__attribute__((target("avx2"))) inline void
+convertS24Avx2(std::span<const std::byte> raw, std::span<float> out) noexcept {
+    const __m256  scale = _mm256_set1_ps(kScale32);
+    const __m256i place = _mm256_broadcastsi128_si256(
+        kOrder == std::endian::little
+            ? _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11)
+            : _mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9));
+
+    // Each lane loads 16 bytes for the 12 it uses, so stop while 4 spare bytes remain
+    std::size_t index = 0U;
+    for (; ((index + 8U) * 3U) + 4U <= raw.size() && index + 8U <= out.size(); index += 8U) {
+        const __m256i bytes = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(loadBytes<__m128i>(raw, index * 3U)),
+            loadBytes<__m128i>(raw, (index * 3U) + 12U),
+            1);
+        const __m256 values = _mm256_cvtepi32_ps(_mm256_shuffle_epi8(bytes, place));
+        _mm256_storeu_ps(&out[index], _mm256_mul_ps(values, scale));
+    }
+
+    convertTail<SampleFormat::S24, kOrder>(raw, out, index);
+}
+
+template <SampleFormat kFormat, std::endian kOrder>
+__attribute__((target("avx2"))) inline void
+convertS32Avx2(std::span<const std::byte> raw, std::span<float> out) noexcept {
+    const __m256  scale = _mm256_set1_ps(kScale32);
+    const __m256i swap  = swapMask(4U);
+
+    std::size_t index = 0U;
+    for (; index + 8U <= out.size(); index += 8U) {
+        auto samples = load256(raw, index * 4U);
+        if constexpr (kOrder == std::endian::big) {
+            samples = _mm256_shuffle_epi8(samples, swap);
+        }
+        if constexpr (kFormat == SampleFormat::S24_32) {
+            samples = _mm256_slli_epi32(samples, 8);
+        }
+        _mm256_storeu_ps(&out[index], _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+    }
+
+    convertTail<kFormat, kOrder>(raw, out, index);
+}
+
+__attribute__((target("avx2"))) inline void
+convertF32SwapAvx2(std::span<const std::byte> raw, std::span<float> out) noexcept {
+    const __m256i swap = swapMask(4U);
+
+    std::size_t index = 0U;
+    for (; index + 8U <= out.size(); index += 8U) {
+        const __m256i samples = _mm256_shuffle_epi8(load256(raw, index * 4U), swap);
+        _mm256_storeu_ps(&out[index], _mm256_castsi256_ps(samples));
+    }
+
+    convertTail<SampleFormat::F32, std::endian::big>(raw, out, index);
+}
+
+template <std::endian kOrder>
+__attribute__((target("avx2"))) inline void
+convertF64Avx2(std::span<const std::byte> raw, std::span<float> out) noexcept {
+    const __m256i swap = swapMask(8U);
+
+    std::size_t index = 0U;
+    for (; index + 4U <= out.size(); index += 4U) {
+        auto samples = load256(raw, index * 8U);
+        if constexpr (kOrder == std::endian::big) {
+            samples = _mm256_shuffle_epi8(samples, swap);
+        }
+        _mm_storeu_ps(&out[index], _mm256_cvtpd_ps(_mm256_castsi256_pd(samples)));
+    }
+
+    convertTail<SampleFormat::F64, kOrder>(raw, out, index);
+}
+
+#elif defined(__ARM_NEON)
+
+// vrev swaps bytes whatever the host order, so these serve the foreign-endian case on any host
+
+template <bool kSwap>
+inline void convertS16Neon(std::span<const std::byte> raw, std::span<float> out) noexcept {
+    std::size_t index = 0U;
+    for (; index + 8U <= out.size(); index += 8U) {
+        auto bytes = vld1q_u8(reinterpret_cast<const std::uint8_t*>(&raw[index * 2U]));
+        if constexpr (kSwap) {
+            bytes = vrev16q_u8(bytes);
+        }
+        const int16x8_t samples = vreinterpretq_s16_u8(bytes);
+        vst1q_f32(&out[index],
+                  vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples))), kScale16));
+        vst1q_f32(&out[index + 4U],
+                  vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples))), kScale16));
+    }
+
+    convertTail<SampleFormat::S16, kSwap ? kForeignEndian : std::endian::native>(raw, out, index);
+}
+
+template <SampleFormat kFormat, bool kSwap>
+inline void convertS32Neon(std::span<const std::byte> raw, std::span<float> out) noexcept {
+    std::size_t index = 0U;
+    for (; index + 4U <= out.size(); index += 4U) {
+        auto bytes = vld1q_u8(reinterpret_cast<const std::uint8_t*>(&raw[index * 4U]));
+        if constexpr (kSwap) {
+            bytes = vrev32q_u8(bytes);
+        }
+        auto samples = vreinterpretq_s32_u8(bytes);
+        if constexpr (kFormat == SampleFormat::S24_32) {
+            samples = vshlq_n_s32(samples, 8);
+        }
+        vst1q_f32(&out[index], vmulq_n_f32(vcvtq_f32_s32(samples), kScale32));
+    }
+
+    convertTail<kFormat, kSwap ? kForeignEndian : std::endian::native>(raw, out, index);
+}
+
+inline void convertF32SwapNeon(std::span<const std::byte> raw, std::span<float> out) noexcept {
+    std::size_t index = 0U;
+    for (; index + 4U <= out.size(); index += 4U) {
+        const auto bytes =
+            vrev32q_u8(vld1q_u8(reinterpret_cast<const std::uint8_t*>(&raw[index * 4U])));
+        vst1q_f32(&out[index], vreinterpretq_f32_u8(bytes));
+    }
+
+    convertTail<SampleFormat::F32, kForeignEndian>(raw, out, index);
+}
+
+#endif
+
+struct ConvertKernels {
+    std::string_view name;
+    // [format][byte order differs from the host's]
+    std::array<std::array<ConvertFn, 2>, kSampleFormatCount> table;
+
+    [[nodiscard]] auto get(SampleSpec spec) const noexcept -> ConvertFn {
+        return table[static_cast<std::size_t>(spec.format)]
+                    [spec.byte_order == std::endian::native ? 0U : 1U];
+    }
+};
+
+template <SampleFormat kFormat>
+[[nodiscard]] constexpr auto scalarKernels() noexcept -> std::array<ConvertFn, 2> {
+    return {&convertScalar<kFormat, std::endian::native>, &convertScalar<kFormat, kForeignEndian>};
+}
+
+// Resolved once from the running CPU, not from the compile flags
+[[nodiscard]] inline auto convertKernels() noexcept -> const ConvertKernels& {
+    static const ConvertKernels kernels = []() noexcept -> ConvertKernels {
+        using enum SampleFormat;
+
+        // Scalar everywhere first, then whatever the CPU can do better
+        ConvertKernels kernels {.name  = "scalar",
+                                .table = {scalarKernels<S16>(),
+                                          scalarKernels<S24>(),
+                                          scalarKernels<S24_32>(),
+                                          scalarKernels<S32>(),
+                                          scalarKernels<F32>(),
+                                          scalarKernels<F64>()}};
+        [[maybe_unused]] const auto slot = [&kernels](SampleFormat format) -> auto& {
+            return kernels.table[static_cast<std::size_t>(format)];
+        };
+
+#if defined(__x86_64__) || defined(__i386__)
+        if (__builtin_cpu_supports("avx2")) {
+            constexpr auto kLittle = std::endian::little;
+            constexpr auto kBig    = std::endian::big;
+
+            slot(S16)    = {&convertS16Avx2<kLittle>, &convertS16Avx2<kBig>};
+            slot(S24)    = {&convertS24Avx2<kLittle>, &convertS24Avx2<kBig>};
+            slot(S24_32) = {&convertS32Avx2<S24_32, kLittle>, &convertS32Avx2<S24_32, kBig>};
+            slot(S32)    = {&convertS32Avx2<S32, kLittle>, &convertS32Avx2<S32, kBig>};
+            slot(F32)[1] = &convertF32SwapAvx2;
+            slot(F64)    = {&convertF64Avx2<kLittle>, &convertF64Avx2<kBig>};
+            kernels.name = "avx2";
+        } else {
+            slot(S16)[0]    = &convertS16Sse2;
+            slot(S24_32)[0] = &convertS32Sse2<S24_32>;
+            slot(S32)[0]    = &convertS32Sse2<S32>;
+            slot(F64)[0]    = &convertF64Sse2;
+            kernels.name    = "sse2";
+        }
+#elif defined(__ARM_NEON)
+        slot(S16)    = {&convertS16Neon<false>, &convertS16Neon<true>};
+        slot(S24_32) = {&convertS32Neon<S24_32, false>, &convertS32Neon<S24_32, true>};
+        slot(S32)    = {&convertS32Neon<S32, false>, &convertS32Neon<S32, true>};
+        slot(F32)[1] = &convertF32SwapNeon;
+        kernels.name = "neon";
+#endif
+        return kernels;
+    }();
+    return kernels;
+}
+
+// Interleaved samples converted per pass when downmixing, 4 KiB of stack
+inline constexpr std::size_t kConvertScratch = 1024U;
+
+}  // namespace audio_blocks::detail
+
+export namespace audio_blocks {
+
+/// Converts the first `out.size()` samples of `raw`, laid out as `spec`, to floats in [-1, 1).
+/// Real-time safe once convertKernelName() has been called, which picks the kernels.
+inline void convert(std::span<const std::byte> raw,
+                    SampleSpec                 spec,
+                    std::span<float>           out) noexcept {
+    out = out.first(std::min(out.size(), raw.size() / spec.bytes()));
+    detail::convertKernels().get(spec)(raw, out);
+}
+
+/// Converts frames [first_frame, first_frame + out.size()) of `pcm` and folds them to mono with
+/// `weights` (laid out for `pcm.channels()`), straight into `out`. Mono input is converted in
+/// place, aligned native floats are downmixed where they lie, anything else goes through a small
+/// stack buffer a few frames at a time.
+inline void convertDownmix(const PcmView&        pcm,
+                           std::size_t           first_frame,
+                           const DownmixWeights& weights,
+                           std::span<float>      out) noexcept {
+    const auto channels = pcm.channels();
+    first_frame         = std::min(first_frame, pcm.frames());
+    out                 = out.first(std::min(out.size(), pcm.frames() - first_frame));
+
+    if (channels == 1U) {
+        convert(pcm.frameSpan(first_frame, out.size()), pcm.spec(), out);
+        return;
+    }
+
+    if (const auto floats = pcm.asF32(); !floats.empty()) {
+        downmix(floats.subspan(first_frame * channels, out.size() * channels), weights, out);
+        return;
+    }
+
+    std::array<float, detail::kConvertScratch> scratch;  // NOLINT: written before every read
+    const auto chunk_frames = scratch.size() / channels;
+
+    for (std::size_t done = 0U; done < out.size();) {
+        const auto count       = std::min(chunk_frames, out.size() - done);
+        const auto interleaved = std::span {scratch}.first(count * channels);
+        convert(pcm.frameSpan(first_frame + done, count), pcm.spec(), interleaved);
+        downmix(interleaved, weights, out.subspan(done, count));
+        done += count;
+    }
+}
+
+[[nodiscard]] inline auto convertKernelName() noexcept -> std::string_view {
+    return detail::convertKernels().name;
+}
+
+}  // namespace audio_blocks
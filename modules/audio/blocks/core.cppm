@@ -1,7 +1,10 @@
 module;
+#include <compare>
 #include <cstddef>
 #include <cstdint>
 #include <expected>
+#include <iterator>
+#include <ranges>
 #include <span>
 #include <string_view>
 #include <type_traits>
@@ -17,8 +20,11 @@ enum class ViewError : std::uint8_t {
     ZeroBlockSize,
     MisalignedBytes,
     UnsupportedStride,
+    ZeroChannels,
 };
 
+inline constexpr std::size_t kViewErrorCount = 5U;
+
 [[nodiscard]] constexpr auto toString(ViewError error) noexcept -> std::string_view {
     switch (error) {
         using enum ViewError;
@@ -27,11 +33,152 @@ enum class ViewError : std::uint8_t {
         case ZeroBlockSize:     return "block size must be > 0"sv;
         case MisalignedBytes:   return "byte size is not a multiple of sample size"sv;
         case UnsupportedStride: return "unsupported stride/layout"sv;
+        case ZeroChannels:      return "channel count must be > 0"sv;
         default:                return "unsupported error"sv;
         // clang-format on
     }
 }
 
+/*
+ * The whole blocks of a span as a random-access, sized, borrowed view of subspans. Block `n` is
+ * computed rather than walked to, so the range works with std::ranges algorithms and views and
+ * can be split across threads by index. Blocks point into the span, never into the range, so
+ * they stay valid after the range itself is gone.
+ */
+template <typename Sample>
+    requires(std::is_trivially_copyable_v<Sample>)
+class BlockRange : public std::ranges::view_interface<BlockRange<Sample>> {
+public:
+    class Iterator {
+    public:
+        // Blocks are produced by value; a span is itself a reference to the samples. Random
+        // access as a C++20 iterator, but only an input iterator to legacy algorithms, which
+        // want `reference` to be `value_type&` (as std::views::iota does)
+        using iterator_concept  = std::random_access_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = std::span<const Sample>;
+        using difference_type   = std::ptrdiff_t;
+
+        constexpr Iterator() = default;
+
+        constexpr Iterator(const Sample* first, std::size_t block, difference_type index) noexcept
+            : first_(first)
+            , block_(block)
+            , index_(index) {}
+
+        [[nodiscard]] constexpr auto operator*() const noexcept -> value_type {
+            return value_type {first_ + (static_cast<std::size_t>(index_) * block_), block_};
+        }
+
+        [[nodiscard]] constexpr auto operator[](difference_type offset) const noexcept
+            -> value_type {
+            return *(*this + offset);
+        }
+
+        constexpr auto operator++() noexcept -> Iterator& {
+            ++index_;
+            return *this;
+        }
+
+        constexpr auto operator++(int) noexcept -> Iterator {
+            auto previous = *this;
+            ++index_;
+            return previous;
+        }
+
+        constexpr auto operator--() noexcept -> Iterator& {
+            --index_;
+            return *this;
+        }
+
+        constexpr auto operator--(int) noexcept -> Iterator {
+            auto previous = *this;
+            --index_;
+            return previous;
+        }
+
+        constexpr auto operator+=(difference_type offset) noexcept -> Iterator& {
+            index_ += offset;
+            return *this;
+        }
+
+        constexpr auto operator-=(difference_type offset) noexcept -> Iterator& {
+            index_ -= offset;
+            return *this;
+        }
+
+        [[nodiscard]] friend constexpr auto operator+(Iterator it, difference_type offset) noexcept
+            -> Iterator {
+            return it += offset;
+        }
+
+        [[nodiscard]] friend constexpr auto operator+(difference_type offset, Iterator it) noexcept
+            -> Iterator {
+            return it += offset;
+        }
+
+        [[nodiscard]] friend constexpr auto operator-(Iterator it, difference_type offset) noexcept
+            -> Iterator {
+            return it -= offset;
+        }
+
+        [[nodiscard]] friend constexpr auto operator-(const Iterator& lhs,
+                                                      const Iterator& rhs) noexcept
+            -> difference_type {
+            return lhs.index_ - rhs.index_;
+        }
+
+        // Only iterators into the same range compare meaningfully
+        [[nodiscard]] friend constexpr auto operator==(const Iterator& lhs,
+                                                       const Iterator& rhs) noexcept -> bool {
+            return lhs.index_ == rhs.index_;
+        }
+
+        [[nodiscard]] friend constexpr auto operator<=>(const Iterator& lhs,
+                                                        const Iterator& rhs) noexcept
+            -> std::strong_ordering {
+            return lhs.index_ <=> rhs.index_;
+        }
+
+    private:
+        const Sample*   first_ {nullptr};
+        std::size_t     block_ {0U};
+        difference_type index_ {0};
+    };
+
+    constexpr BlockRange() = default;
+
+    constexpr BlockRange(std::span<const Sample> all, std::size_t block) noexcept
+        : all_(all)
+        , block_(block) {}
+
+    [[nodiscard]] constexpr auto begin() const noexcept -> Iterator {
+        return Iterator {all_.data(), block_, 0};
+    }
+
+    [[nodiscard]] constexpr auto end() const noexcept -> Iterator {
+        return Iterator {all_.data(), block_, static_cast<std::ptrdiff_t>(size())};
+    }
+
+    [[nodiscard]] constexpr auto size() const noexcept -> std::size_t {
+        return block_ == 0U ? 0U : all_.size() / block_;
+    }
+
+    // Block `index` < size()
+    [[nodiscard]] constexpr auto operator[](std::size_t index) const noexcept
+        -> std::span<const Sample> {
+        return all_.subspan(index * block_, block_);
+    }
+
+    [[nodiscard]] constexpr auto blockSize() const noexcept -> std::size_t {
+        return block_;
+    }
+
+private:
+    std::span<const Sample> all_ {};
+    std::size_t             block_ {};
+};
+
 template <typename Sample>
     requires(std::is_trivially_copyable_v<Sample>)
 class BufferView {
@@ -61,56 +208,8 @@ public:
         return samples_.size();
     }
 
-    class BlockRange {
-    public:
-        class Iterator {
-        public:
-            using ValueType      = std::span<const SampleType>;
-            using DifferenceType = std::ptrdiff_t;
-
-            constexpr Iterator(std::span<const SampleType> all,
-                               std::size_t                 block,
-                               std::size_t                 offset)
-                : all_(all)
-                , block_(block)
-                , offset_(offset) {}
-
-            [[nodiscard]] constexpr auto operator!=(const Iterator& rhs) const noexcept -> bool {
-                return offset_ != rhs.offset_;
-            }
-
-            [[nodiscard]] constexpr auto operator*() const noexcept -> ValueType {
-                return all_.subspan(offset_, block_);
-            }
-
-            constexpr auto operator++() noexcept -> Iterator& {
-                offset_ += block_;
-                return *this;
-            }
-
-        private:
-            std::span<const SampleType> all_ {};
-            std::size_t                 block_ {};
-            std::size_t                 offset_ {};
-        };
-
-        constexpr BlockRange(std::span<const SampleType> all, std::size_t block) noexcept
-            : all_(all)
-            , block_(block) {}
-
-        [[nodiscard]] constexpr auto begin() const noexcept -> Iterator {
-            return Iterator {all_, block_, 0};
-        }
-
-        [[nodiscard]] constexpr auto end() const noexcept -> Iterator {
-            const std::size_t usable = (all_.size() / block_) * block_;
-            return Iterator {all_, block_, usable};
-        }
-
-    private:
-        std::span<const SampleType> all_ {};
-        std::size_t                 block_ {};
-    };
+    // Whole blocks only; what is left over is tailPartial()
+    using BlockRange = audio_blocks::BlockRange<SampleType>;
 
     [[nodiscard]] constexpr auto blocks() const noexcept -> BlockRange {
         return BlockRange {samples_, block_size_};
@@ -126,6 +225,72 @@ private:
     std::size_t                 block_size_ {};
 };
 
+/// Interleaved multichannel samples, frame after frame.
+template <typename Sample>
+    requires(std::is_trivially_copyable_v<Sample>)
+class InterleavedView {
+public:
+    using SampleType = Sample;
+
+    constexpr InterleavedView() = default;
+
+    constexpr InterleavedView(std::span<const SampleType> samples, std::size_t channels) noexcept
+        : samples_(samples)
+        , channels_(channels) {}
+
+    [[nodiscard]] constexpr auto samples() const noexcept -> std::span<const SampleType> {
+        return samples_;
+    }
+
+    [[nodiscard]] constexpr auto channels() const noexcept -> std::size_t {
+        return channels_;
+    }
+
+    [[nodiscard]] constexpr auto frames() const noexcept -> std::size_t {
+        return samples_.size() / channels_;
+    }
+
+    [[nodiscard]] constexpr auto empty() const noexcept -> bool {
+        return samples_.empty();
+    }
+
+    // Samples of frames [first_frame, first_frame + frame_count)
+    [[nodiscard]] constexpr auto frameSpan(std::size_t first_frame,
+                                           std::size_t frame_count) const noexcept
+        -> std::span<const SampleType> {
+        return samples_.subspan(first_frame * channels_, frame_count * channels_);
+    }
+
+private:
+    std::span<const SampleType> samples_ {};
+    std::size_t                 channels_ {1U};
+};
+
+template <typename Sample>
+    requires(std::is_trivially_copyable_v<Sample>)
+[[nodiscard]] inline auto makeInterleavedViewFromBytes(const void* data,
+                                                       std::size_t byte_size,
+                                                       std::size_t channels) noexcept
+    -> std::expected<InterleavedView<Sample>, ViewError> {
+    using enum ViewError;
+
+    if (data == nullptr) {
+        return std::unexpected {NullData};
+    }
+
+    if (channels == 0U) {
+        return std::unexpected {ZeroChannels};
+    }
+
+    // Only whole frames
+    if (byte_size % (sizeof(Sample) * channels)) {
+        return std::unexpected {MisalignedBytes};
+    }
+
+    const auto count = byte_size / sizeof(Sample);
+    return InterleavedView<Sample> {std::span {static_cast<const Sample*>(data), count}, channels};
+}
+
 template <typename Sample>
     requires(std::is_trivially_copyable_v<Sample>)
 [[nodiscard]] constexpr auto makeBufferViewFromSpan(std::span<const Sample> samples,
@@ -165,3 +330,13 @@ template <typename Sample>
                                block_size_samples};
 }
 }  // namespace audio_blocks
+
+// Blocks are subspans of the viewed samples, not of the range
+template <typename Sample>
+    requires(std::is_trivially_copyable_v<Sample>)
+inline constexpr bool std::ranges::enable_borrowed_range<audio_blocks::BlockRange<Sample>> = true;
+
+static_assert(std::ranges::random_access_range<audio_blocks::BlockRange<float>>);
+static_assert(std::ranges::sized_range<audio_blocks::BlockRange<float>>);
+static_assert(std::ranges::view<audio_blocks::BlockRange<float>>);
+static_assert(std::ranges::borrowed_range<audio_blocks::BlockRange<float>>);
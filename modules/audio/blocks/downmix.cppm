@@ -0,0 +1,219 @@
+module;
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+export module audio.blocks:downmix;
+
+export namespace audio_blocks {
+
+inline constexpr std::size_t kMaxChannels = 64U;  // SPA_AUDIO_MAX_CHANNELS
+
+/// Per-channel gains applied while folding interleaved frames down to mono.
+class DownmixWeights {
+public:
+    constexpr DownmixWeights() = default;
+
+    // Equal-gain average of every channel
+    [[nodiscard]] static constexpr auto average(std::size_t channels) noexcept -> DownmixWeights {
+        DownmixWeights weights {channels};
+        std::ranges::fill(weights.activeGains(), 1.0F / static_cast<float>(weights.channels_));
+        return weights;
+    }
+
+    // A single channel passed through untouched
+    [[nodiscard]] static constexpr auto select(std::size_t channels, std::size_t channel) noexcept
+        -> DownmixWeights {
+        DownmixWeights weights {channels};
+        weights.gains_[std::min(channel, weights.channels_ - 1U)] = 1.0F;
+        return weights;
+    }
+
+    [[nodiscard]] constexpr auto channels() const noexcept -> std::size_t {
+        return channels_;
+    }
+
+    [[nodiscard]] constexpr auto gains() const noexcept -> std::span<const float> {
+        return std::span {gains_}.first(channels_);
+    }
+
+private:
+    constexpr explicit DownmixWeights(std::size_t channels) noexcept
+        : channels_(std::clamp<std::size_t>(channels, 1U, kMaxChannels)) {}
+
+    constexpr auto activeGains() noexcept -> std::span<float> {
+        return std::span {gains_}.first(channels_);
+    }
+
+    std::array<float, kMaxChannels> gains_ {};
+    std::size_t                     channels_ {1U};
+};
+
+}  // namespace audio_blocks
+
+namespace audio_blocks::detail {
+
+using DownmixFn = void (*)(std::span<const float>, std::span<const float>, std::span<float>);
+
+// Reference kernel, also finishes the frames the vector kernels leave over
+inline void downmixScalar(std::span<const float> interleaved,
+                          std::span<const float> gains,
+                          std::span<float>       out) noexcept {
+    const auto channels = gains.size();
+    for (std::size_t frame = 0U; frame < out.size(); ++frame) {
+        float sum = 0.0F;
+        for (std::size_t channel = 0U; channel < channels; ++channel) {
+            sum += interleaved[(frame * channels) + channel] * gains[channel];
+        }
+        out[frame] = sum;
+    }
+}
+
+// Frames [done, out.size()) through the scalar kernel
+inline void downmixTail(std::span<const float> interleaved,
+                        std::span<const float> gains,
+                        std::span<float>       out,
+                        std::size_t            done) noexcept {
+    downmixScalar(interleaved.subspan(done * gains.size()), gains, out.subspan(done));
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// SSE2 is part of the x86-64 baseline
+inline void downmixStereoSse2(std::span<const float> interleaved,
+                              std::span<const float> gains,
+                              std::span<float>       out) noexcept {
+    const __m128 left  = _mm_set1_ps(gains[0]);
+    const __m128 right = _mm_set1_ps(gains[1]);
+
+    std::size_t frame = 0U;
+    for (; frame + 4U <= out.size(); frame += 4U) {
+        const __m128 first  = _mm_loadu_ps(&interleaved[frame * 2U]);
+        const __m128 second = _mm_loadu_ps(&interleaved[(frame * 2U) + 4U]);
+        const __m128 even   = _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 odd    = _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(&out[frame], _mm_add_ps(_mm_mul_ps(even, left), _mm_mul_ps(odd, right)));
+    }
+
+    downmixTail(interleaved, gains, out, frame);
+}
+
+__attribute__((target("avx2"))) inline void downmixStereoAvx2(std::span<const float> interleaved,
+                                                              std::span<const float> gains,
+                                                              std::span<float>       out) noexcept {
+    const float  left    = gains[0];
+    const float  right   = gains[1];
+    const __m256 weights = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+
+    std::size_t frame = 0U;
+    for (; frame + 8U <= out.size(); frame += 8U) {
+        const __m256 first  = _mm256_mul_ps(_mm256_loadu_ps(&interleaved[frame * 2U]), weights);
+        const __m256 second = _mm256_mul_ps(_mm256_loadu_ps(&interleaved[(frame * 2U) + 8U]),
+                                            weights);
+
+        // Per 128-bit lane: frames {0, 1, 4, 5} and {2, 3, 6, 7}, put back in order below
+        const __m256  sums    = _mm256_hadd_ps(first, second);
+        const __m256d ordered = _mm256_permute4x64_pd(_mm256_castps_pd(sums), 0b11'01'10'00);
+        _mm256_storeu_ps(&out[frame], _mm256_castpd_ps(ordered));
+    }
+
+    downmixTail(interleaved, gains, out, frame);
+}
+
+// Any channel count: eight frames at a time, one strided gather per channel
+__attribute__((target("avx2"))) inline void downmixGatherAvx2(std::span<const float> interleaved,
+                                                              std::span<const float> gains,
+                                                              std::span<float>       out) noexcept {
+    const auto channels = gains.size();
+    const auto stride   = static_cast<std::int32_t>(channels);
+    const auto offsets  = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                             _mm256_set1_epi32(stride));
+
+    std::size_t frame = 0U;
+    for (; frame + 8U <= out.size(); frame += 8U) {
+        __m256 sum = _mm256_setzero_ps();
+        for (std::size_t channel = 0U; channel < channels; ++channel) {
+            const __m256 samples =
+                _mm256_i32gather_ps(&interleaved[(frame * channels) + channel], offsets, 4);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(samples, _mm256_set1_ps(gains[channel])));
+        }
+        _mm256_storeu_ps(&out[frame], sum);
+    }
+
+    downmixTail(interleaved, gains, out, frame);
+}
+
+#elif defined(__ARM_NEON)
+
+inline void downmixStereoNeon(std::span<const float> interleaved,
+                              std::span<const float> gains,
+                              std::span<float>       out) noexcept {
+    std::size_t frame = 0U;
+    for (; frame + 4U <= out.size(); frame += 4U) {
+        const float32x4x2_t channels = vld2q_f32(&interleaved[frame * 2U]);
+        vst1q_f32(&out[frame],
+                  vmlaq_n_f32(vmulq_n_f32(channels.val[0], gains[0]), channels.val[1], gains[1]));
+    }
+
+    downmixTail(interleaved, gains, out, frame);
+}
+
+#endif
+
+struct DownmixKernels {
+    std::string_view name;
+    DownmixFn        stereo;
+    DownmixFn        any;
+};
+
+// Resolved once from the running CPU, not from the compile flags
+[[nodiscard]] inline auto downmixKernels() noexcept -> const DownmixKernels& {
+    static const DownmixKernels kernels = []() noexcept -> DownmixKernels {
+#if defined(__x86_64__) || defined(__i386__)
+        if (__builtin_cpu_supports("avx2")) {
+            return {.name = "avx2", .stereo = &downmixStereoAvx2, .any = &downmixGatherAvx2};
+        }
+        return {.name = "sse2", .stereo = &downmixStereoSse2, .any = &downmixScalar};
+#elif defined(__ARM_NEON)
+        return {.name = "neon", .stereo = &downmixStereoNeon, .any = &downmixScalar};
+#else
+        return {.name = "scalar", .stereo = &downmixScalar, .any = &downmixScalar};
+#endif
+    }();
+    return kernels;
+}
+
+}  // namespace audio_blocks::detail
+
+export namespace audio_blocks {
+
+/// Mixes `out.size()` frames of `interleaved` (laid out with `weights.channels()` channels)
+/// into `out`. Real-time safe once downmixKernelName() has been called, which picks the kernel.
+inline void downmix(std::span<const float> interleaved,
+                    const DownmixWeights&  weights,
+                    std::span<float>       out) noexcept {
+    const auto  gains   = weights.gains();
+    const auto& kernels = detail::downmixKernels();
+    out                 = out.first(std::min(out.size(), interleaved.size() / gains.size()));
+
+    if (gains.size() == 2U) {
+        kernels.stereo(interleaved, gains, out);
+    } else {
+        kernels.any(interleaved, gains, out);
+    }
+}
+
+[[nodiscard]] inline auto downmixKernelName() noexcept -> std::string_view {
+    return detail::downmixKernels().name;
+}
+
+}  // namespace audio_blocks
@@ -1,4 +1,7 @@
 export module audio.blocks;
 
 export import :core;
+export import :accumulator;
+export import :convert;
+export import :downmix;
 export import :spa;
@@ -1,11 +1,17 @@
 module;
 #include <spa/buffer/buffer.h>
+#include <spa/param/audio/raw.h>
 
+#include <array>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
 #include <expected>
+#include <optional>
 
 export module audio.blocks:spa;
 
+import :convert;
 import :core;
 
 namespace audio_blocks::detail {
@@ -36,6 +42,46 @@ namespace audio_blocks::detail {
 }  // namespace audio_blocks::detail
 
 export namespace audio_blocks {
+
+struct SpaSampleFormat {
+    spa_audio_format spa;
+    SampleSpec       spec;
+};
+
+/// Every raw format convert() handles, in the order the capture stream offers them: host-order
+/// float first, since it needs no conversion at all, then what devices tend to produce natively.
+inline constexpr auto kSpaSampleFormats = [] {
+    using enum SampleFormat;
+    constexpr auto kHost    = std::endian::native;
+    constexpr auto kForeign = kHost == std::endian::little ? std::endian::big : std::endian::little;
+
+    return std::to_array<SpaSampleFormat>({
+        {.spa = SPA_AUDIO_FORMAT_F32, .spec = {.format = F32, .byte_order = kHost}},
+        {.spa = SPA_AUDIO_FORMAT_S32, .spec = {.format = S32, .byte_order = kHost}},
+        {.spa = SPA_AUDIO_FORMAT_S24_32, .spec = {.format = S24_32, .byte_order = kHost}},
+        {.spa = SPA_AUDIO_FORMAT_S24, .spec = {.format = S24, .byte_order = kHost}},
+        {.spa = SPA_AUDIO_FORMAT_S16, .spec = {.format = S16, .byte_order = kHost}},
+        {.spa = SPA_AUDIO_FORMAT_F64, .spec = {.format = F64, .byte_order = kHost}},
+        {.spa = SPA_AUDIO_FORMAT_F32_OE, .spec = {.format = F32, .byte_order = kForeign}},
+        {.spa = SPA_AUDIO_FORMAT_S32_OE, .spec = {.format = S32, .byte_order = kForeign}},
+        {.spa = SPA_AUDIO_FORMAT_S24_32_OE, .spec = {.format = S24_32, .byte_order = kForeign}},
+        {.spa = SPA_AUDIO_FORMAT_S24_OE, .spec = {.format = S24, .byte_order = kForeign}},
+        {.spa = SPA_AUDIO_FORMAT_S16_OE, .spec = {.format = S16, .byte_order = kForeign}},
+        {.spa = SPA_AUDIO_FORMAT_F64_OE, .spec = {.format = F64, .byte_order = kForeign}},
+    });
+}();
+
+[[nodiscard]] constexpr auto sampleSpecFromSpa(std::uint32_t spa_format) noexcept
+    -> std::optional<SampleSpec> {
+    for (const auto& format : kSpaSampleFormats) {
+        if (static_cast<std::uint32_t>(format.spa) == spa_format) {
+            return format.spec;
+        }
+    }
+
+    return std::nullopt;
+}
+
 [[nodiscard]] inline auto makeBufferViewFromSpaMonoF32(const spa_buffer* buffer,
                                                        std::size_t block_size_samples) noexcept
     -> std::expected<audio_blocks::BufferView<float>, audio_blocks::ViewError> {
@@ -62,4 +108,51 @@ export namespace audio_blocks {
     return audio_blocks::makeBufferViewFromBytes<float>(data_ptr, byte_count, block_size_samples);
 }
 
+[[nodiscard]] inline auto makeInterleavedViewFromSpaF32(const spa_buffer* buffer,
+                                                        std::size_t       channels) noexcept
+    -> std::expected<audio_blocks::InterleavedView<float>, audio_blocks::ViewError> {
+    using namespace audio_blocks::detail;
+    using enum audio_blocks::ViewError;
+
+    const void* data_ptr   = spaDataPtr(buffer);
+    const auto  byte_count = spaSizeBytes(buffer);
+    const auto  frame_size = sizeof(float) * channels;
+
+    if (data_ptr == nullptr) {
+        return std::unexpected {NullData};
+    }
+    if (channels == 0U) {
+        return std::unexpected {ZeroChannels};
+    }
+    if (spaStrideBytes(buffer, frame_size) != frame_size) {
+        return std::unexpected {UnsupportedStride};
+    }
+
+    return audio_blocks::makeInterleavedViewFromBytes<float>(data_ptr, byte_count, channels);
+}
+
+[[nodiscard]] inline auto makePcmViewFromSpa(const spa_buffer* buffer,
+                                             SampleSpec        spec,
+                                             std::size_t       channels) noexcept
+    -> std::expected<audio_blocks::PcmView, audio_blocks::ViewError> {
+    using namespace audio_blocks::detail;
+    using enum audio_blocks::ViewError;
+
+    const void* data_ptr   = spaDataPtr(buffer);
+    const auto  byte_count = spaSizeBytes(buffer);
+    const auto  frame_size = spec.bytes() * channels;
+
+    if (data_ptr == nullptr) {
+        return std::unexpected {NullData};
+    }
+    if (channels == 0U) {
+        return std::unexpected {ZeroChannels};
+    }
+    if (spaStrideBytes(buffer, frame_size) != frame_size) {
+        return std::unexpected {UnsupportedStride};
+    }
+
+    return audio_blocks::makePcmViewFromBytes(data_ptr, byte_count, spec, channels);
+}
+
 }  // namespace audio_blocks
@@ -0,0 +1,62 @@
+module;
+#include <cstdint>
+#include <string_view>
+
+export module audio.wav:core;
+
+export namespace audio_wav {
+
+using namespace std::string_view_literals;
+
+enum class WavError : std::uint8_t {
+    OpenFailed,
+    MapFailed,
+    NotRiffWave,
+    MissingFormat,
+    MissingData,
+    UnsupportedEncoding,
+    TooManyChannels,
+    Truncated,
+};
+
+[[nodiscard]] constexpr auto toString(WavError error) noexcept -> std::string_view {
+    switch (error) {
+        using enum WavError;
+        // clang-format off
+        case OpenFailed:          return "cannot open file"sv;
+        case MapFailed:           return "cannot map file"sv;
+        case NotRiffWave:         return "not a RIFF/WAVE file"sv;
+        case MissingFormat:       return "missing or malformed 'fmt ' chunk"sv;
+        case MissingData:         return "missing 'data' chunk"sv;
+        case UnsupportedEncoding: return "unsupported sample encoding"sv;
+        case TooManyChannels:     return "too many channels"sv;
+        case Truncated:           return "file is truncated"sv;
+        default:                  return "unsupported error"sv;
+        // clang-format on
+    }
+}
+
+// Sample encodings we can decode, all little-endian as mandated by RIFF
+enum class SampleEncoding : std::uint8_t {
+    S16,
+    S24,
+    S32,
+    F32,
+    F64,
+};
+
+[[nodiscard]] constexpr auto bytesPerSample(SampleEncoding encoding) noexcept -> std::uint32_t {
+    switch (encoding) {
+        using enum SampleEncoding;
+        // clang-format off
+        case S16: return 2U;
+        case S24: return 3U;
+        case S32: return 4U;
+        case F32: return 4U;
+        case F64: return 8U;
+        default:  return 0U;
+        // clang-format on
+    }
+}
+
+}  // namespace audio_wav
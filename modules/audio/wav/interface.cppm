@@ -0,0 +1,5 @@
+export module audio.wav;
+
+export import :core;
+export import :mapped;
+export import :reader;
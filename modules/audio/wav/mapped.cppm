@@ -0,0 +1,122 @@
+module;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <span>
+#include <utility>
+
+export module audio.wav:mapped;
+
+import :core;
+
+export namespace audio_wav {
+
+/// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    MappedFile(const MappedFile&)                    = delete;
+    auto operator=(const MappedFile&) -> MappedFile& = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr))
+        , size_(std::exchange(other.size_, 0U)) {}
+
+    auto operator=(MappedFile&& other) noexcept -> MappedFile& {
+        if (this != &other) {
+            unmap();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0U);
+        }
+        return *this;
+    }
+
+    ~MappedFile() {
+        unmap();
+    }
+
+    [[nodiscard]] static auto open(const std::filesystem::path& path)
+        -> std::expected<MappedFile, WavError> {
+        using enum WavError;
+
+        const int file_descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file_descriptor < 0) {
+            return std::unexpected {OpenFailed};
+        }
+
+        // The mapping keeps the file alive, the descriptor is not needed past mmap()
+        struct FdGuard {
+            int file_descriptor;
+            ~FdGuard() {
+                ::close(file_descriptor);
+            }
+        } guard {file_descriptor};
+
+        struct stat file_stat {};
+        if (::fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size <= 0) {
+            return std::unexpected {Truncated};
+        }
+
+        const auto size = static_cast<std::size_t>(file_stat.st_size);
+        void*      data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+        if (data == MAP_FAILED) {
+            return std::unexpected {MapFailed};
+        }
+
+        MappedFile mapped {};
+        mapped.data_ = data;
+        mapped.size_ = size;
+        return mapped;
+    }
+
+    [[nodiscard]] auto bytes() const noexcept -> std::span<const std::byte> {
+        return {static_cast<const std::byte*>(data_), size_};
+    }
+
+    // Hint that the mapping is read front to back so the kernel reads ahead aggressively
+    void adviseSequential() const noexcept {
+        if (data_ != nullptr) {
+            (void) ::madvise(data_, size_, MADV_SEQUENTIAL);
+        }
+    }
+
+    // Drops the pages backing `range` (a sub-span of bytes()) from this process, up to the last
+    // page boundary inside it; they are read back from the file if touched again. Releasing
+    // consecutive ranges therefore leaves no gaps, which keeps streaming reads of huge files
+    // bounded.
+    void release(std::span<const std::byte> range) const noexcept {
+        if (data_ == nullptr || range.empty()) {
+            return;
+        }
+
+        static const auto page_size = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+
+        const auto begin = reinterpret_cast<std::uintptr_t>(range.data());
+        const auto first = begin & ~(page_size - 1U);
+        const auto last  = (begin + range.size()) & ~(page_size - 1U);
+        if (first < last) {
+            (void) ::madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+        }
+    }
+
+private:
+    void unmap() noexcept {
+        if (data_ != nullptr) {
+            ::munmap(data_, size_);
+            data_ = nullptr;
+            size_ = 0U;
+        }
+    }
+
+    void*       data_ {nullptr};
+    std::size_t size_ {0U};
+};
+
+}  // namespace audio_wav
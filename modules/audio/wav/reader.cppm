@@ -0,0 +1,264 @@
+module;
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <utility>
+
+export module audio.wav:reader;
+
+import :core;
+import :mapped;
+import audio.blocks;
+
+namespace audio_wav::detail {
+
+constexpr std::uint16_t kFormatPcm        = 0x0001U;
+constexpr std::uint16_t kFormatFloat      = 0x0003U;
+constexpr std::uint16_t kFormatExtensible = 0xFFFEU;
+
+constexpr std::size_t kChunkHeaderBytes = 8U;
+constexpr std::size_t kMinFormatBytes   = 16U;
+constexpr std::size_t kExtensibleBytes  = 40U;
+
+[[nodiscard]] inline auto readU16(std::span<const std::byte> bytes) noexcept -> std::uint16_t {
+    return static_cast<std::uint16_t>(std::to_integer<std::uint32_t>(bytes[0])
+                                      | (std::to_integer<std::uint32_t>(bytes[1]) << 8U));
+}
+
+[[nodiscard]] inline auto readU24(std::span<const std::byte> bytes) noexcept -> std::uint32_t {
+    return std::to_integer<std::uint32_t>(bytes[0])
+           | (std::to_integer<std::uint32_t>(bytes[1]) << 8U)
+           | (std::to_integer<std::uint32_t>(bytes[2]) << 16U);
+}
+
+[[nodiscard]] inline auto readU32(std::span<const std::byte> bytes) noexcept -> std::uint32_t {
+    return readU24(bytes) | (std::to_integer<std::uint32_t>(bytes[3]) << 24U);
+}
+
+[[nodiscard]] inline auto hasTag(std::span<const std::byte> bytes, std::string_view tag) noexcept
+    -> bool {
+    return bytes.size() >= tag.size()
+           && std::ranges::equal(bytes.first(tag.size()), tag, [](std::byte byte, char character) {
+                  return std::to_integer<char>(byte) == character;
+              });
+}
+
+[[nodiscard]] inline auto encodingFor(std::uint16_t format_tag, std::uint16_t bits) noexcept
+    -> std::expected<SampleEncoding, WavError> {
+    using enum SampleEncoding;
+
+    if (format_tag == kFormatPcm) {
+        // clang-format off
+        switch (bits) {
+            case 16U: return S16;
+            case 24U: return S24;
+            case 32U: return S32;
+            default:  break;
+        }
+        // clang-format on
+    } else if (format_tag == kFormatFloat) {
+        // clang-format off
+        switch (bits) {
+            case 32U: return F32;
+            case 64U: return F64;
+            default:  break;
+        }
+        // clang-format on
+    }
+
+    return std::unexpected {WavError::UnsupportedEncoding};
+}
+
+[[nodiscard]] constexpr auto sampleFormatFor(SampleEncoding encoding) noexcept
+    -> audio_blocks::SampleFormat {
+    switch (encoding) {
+        using enum SampleEncoding;
+        // clang-format off
+        case S16: return audio_blocks::SampleFormat::S16;
+        case S24: return audio_blocks::SampleFormat::S24;
+        case S32: return audio_blocks::SampleFormat::S32;
+        case F64: return audio_blocks::SampleFormat::F64;
+        default:  return audio_blocks::SampleFormat::F32;
+        // clang-format on
+    }
+}
+
+}  // namespace audio_wav::detail
+
+export namespace audio_wav {
+
+/*
+ * A memory-mapped PCM/IEEE-float WAV file.
+ *
+ * The file is mapped once and decoded straight out of the page cache; nothing is read into
+ * heap memory, so even multi-hour recordings cost only the pages currently being touched.
+ */
+class WavFile {
+public:
+    [[nodiscard]] static auto open(const std::filesystem::path& path)
+        -> std::expected<WavFile, WavError> {
+        using namespace detail;
+        using enum WavError;
+
+        auto mapped = MappedFile::open(path);
+        if (!mapped) {
+            return std::unexpected {mapped.error()};
+        }
+
+        const auto bytes = mapped->bytes();
+        if (bytes.size() < 12U || !hasTag(bytes, "RIFF") || !hasTag(bytes.subspan(8U), "WAVE")) {
+            return std::unexpected {NotRiffWave};
+        }
+
+        WavFile file {};
+        bool    saw_format = false;
+
+        // Walk the chunk list, 'fmt ' must precede 'data'
+        std::size_t offset = 12U;
+        while (offset + kChunkHeaderBytes <= bytes.size()) {
+            const auto chunk      = bytes.subspan(offset);
+            const auto chunk_size = static_cast<std::size_t>(readU32(chunk.subspan(4U)));
+            const auto body       = chunk.subspan(kChunkHeaderBytes);
+            const auto available  = std::min(chunk_size, body.size());
+
+            if (hasTag(chunk, "fmt ")) {
+                if (available < kMinFormatBytes) {
+                    return std::unexpected {MissingFormat};
+                }
+
+                auto format_tag = readU16(body);
+                if (format_tag == kFormatExtensible && available >= kExtensibleBytes) {
+                    // The first two bytes of the SubFormat GUID carry the real format tag
+                    format_tag = readU16(body.subspan(24U));
+                }
+
+                file.channels_    = readU16(body.subspan(2U));
+                file.sample_rate_ = readU32(body.subspan(4U));
+
+                const auto encoding = encodingFor(format_tag, readU16(body.subspan(14U)));
+                if (!encoding) {
+                    return std::unexpected {encoding.error()};
+                }
+                file.encoding_ = *encoding;
+
+                if (file.channels_ == 0U || file.sample_rate_ == 0U) {
+                    return std::unexpected {MissingFormat};
+                }
+                if (file.channels_ > audio_blocks::kMaxChannels) {
+                    return std::unexpected {TooManyChannels};
+                }
+
+                file.frame_bytes_ = file.channels_ * bytesPerSample(file.encoding_);
+                saw_format        = true;
+            } else if (hasTag(chunk, "data")) {
+                if (!saw_format) {
+                    return std::unexpected {MissingFormat};
+                }
+
+                // Tolerate truncated files (and streaming writers that never patch the size)
+                file.data_ = body.first(available);
+                break;
+            }
+
+            // Chunks are padded to an even number of bytes
+            offset += kChunkHeaderBytes + chunk_size + (chunk_size & 1U);
+        }
+
+        if (!saw_format) {
+            return std::unexpected {MissingFormat};
+        }
+        if (file.data_.empty()) {
+            return std::unexpected {MissingData};
+        }
+
+        mapped->adviseSequential();
+        file.mapping_ = std::move(*mapped);
+        return file;
+    }
+
+    [[nodiscard]] auto sampleRate() const noexcept -> std::uint32_t {
+        return sample_rate_;
+    }
+
+    [[nodiscard]] auto channels() const noexcept -> std::uint32_t {
+        return channels_;
+    }
+
+    [[nodiscard]] auto encoding() const noexcept -> SampleEncoding {
+        return encoding_;
+    }
+
+    [[nodiscard]] auto frames() const noexcept -> std::uint64_t {
+        return data_.size() / frame_bytes_;
+    }
+
+    [[nodiscard]] auto durationSeconds() const noexcept -> double {
+        return static_cast<double>(frames()) / static_cast<double>(sample_rate_);
+    }
+
+    // Samples of a mono F32 file viewed in place, empty when the file needs decoding
+    [[nodiscard]] auto monoF32() const noexcept -> std::span<const float> {
+        const bool in_place = channels_ == 1U && encoding_ == SampleEncoding::F32
+                              && std::endian::native == std::endian::little
+                              && reinterpret_cast<std::uintptr_t>(data_.data()) % alignof(float)
+                                     == 0U;
+        if (!in_place) {
+            return {};
+        }
+
+        return {reinterpret_cast<const float*>(data_.data()), data_.size() / sizeof(float)};
+    }
+
+    // Decodes frames starting at `first_frame` into `out`, averaging all channels down to mono.
+    // Returns the number of frames written, which is short only at the end of the file.
+    [[nodiscard]] auto decodeMono(std::uint64_t first_frame, std::span<float> out) const noexcept
+        -> std::size_t {
+        if (first_frame >= frames()) {
+            return 0U;
+        }
+
+        const auto count = static_cast<std::size_t>(
+            std::min<std::uint64_t>(out.size(), frames() - first_frame));
+
+        // RIFF data is little-endian whatever the host
+        const audio_blocks::PcmView pcm {
+            data_,
+            audio_blocks::SampleSpec {.format     = detail::sampleFormatFor(encoding_),
+                                      .byte_order = std::endian::little},
+            channels_};
+        audio_blocks::convertDownmix(pcm,
+                                     static_cast<std::size_t>(first_frame),
+                                     audio_blocks::DownmixWeights::average(channels_),
+                                     out.first(count));
+
+        return count;
+    }
+
+    // Releases the mapped pages holding frames [first_frame, end_frame) once they have been
+    // consumed. Calling this for consecutive ranges while streaming leaves no pages behind.
+    void release(std::uint64_t first_frame, std::uint64_t end_frame) const noexcept {
+        const auto first = std::min<std::uint64_t>(first_frame, frames());
+        const auto end   = std::min<std::uint64_t>(end_frame, frames());
+        if (first < end) {
+            mapping_.release(data_.subspan(static_cast<std::size_t>(first) * frame_bytes_,
+                                           static_cast<std::size_t>(end - first) * frame_bytes_));
+        }
+    }
+
+private:
+    WavFile() = default;
+
+    MappedFile                 mapping_ {};
+    std::span<const std::byte> data_ {};
+    std::uint32_t              sample_rate_ {0U};
+    std::uint32_t              channels_ {0U};
+    std::uint32_t              frame_bytes_ {0U};
+    SampleEncoding             encoding_ {SampleEncoding::S16};
+};
+
+}  // namespace audio_wav
@@ -0,0 +1,407 @@
+module;
+#include <aubio/types.h>
+
+// peakpicker and beattracking are only exposed by aubio.h when AUBIO_UNSTABLE is set
+#define AUBIO_UNSTABLE 1
+
+#include <aubio/cvec.h>
+#include <aubio/fvec.h>
+#include <aubio/musicutils.h>
+#include <aubio/onset/onset.h>
+#include <aubio/onset/peakpicker.h>
+#include <aubio/pitch/pitch.h>
+#include <aubio/spectral/awhitening.h>
+#include <aubio/spectral/phasevoc.h>
+#include <aubio/spectral/specdesc.h>
+#include <aubio/tempo/beattracking.h>
+#include <aubio/tempo/tempo.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string>
+#include <type_traits>
+
+export module beat.detector:analysis;
+
+import :aubio_raii;
+import support.trace;
+
+export namespace beat {
+
+/*
+ * A beat and/or onset detected in one analysis block.
+ *
+ * Live events are timestamped on the graph clock at the sample the beat fell on (the block's
+ * first sample for onset-only events); offline ones carry the time their block was analyzed.
+ */
+struct Event {
+    bool          is_beat;
+    bool          is_onset;
+    float         bpm;
+    float         pitch_hz;
+    double        process_ms;
+    std::uint64_t frame;         // stream position (in samples) of the first sample of the block
+    std::uint32_t beat_offset;   // samples from `frame` to the beat, 0 for onset-only events
+    std::uint64_t timestamp_ns;  // CLOCK_MONOTONIC, see above
+    std::uint32_t stream;        // capture stream that produced it, 0 when analyzing a file
+};
+
+}  // namespace beat
+
+namespace beat {
+
+static_assert(std::is_same_v<smpl_t, float>, "aubio must be built with single precision samples");
+
+struct AnalysisConfig {
+    std::uint32_t buffer_size;
+    std::uint32_t fft_size;
+    std::uint32_t sample_rate;
+    bool          pitch_enabled;
+};
+
+struct BlockResult {
+    bool          is_beat;
+    bool          is_onset;
+    float         pitch_hz;
+    std::uint32_t beat_offset;  // samples from the start of the block to the beat
+};
+
+/*
+ * The tempo/onset/pitch pipeline shared by the real-time and offline paths.
+ *
+ * `aubio_tempo_do` and `aubio_onset_do` each run their own phase vocoder (window + FFT) over
+ * the very same input with the very same window/hop. Instead we run a single `aubio_pvoc_t`
+ * per hop and feed its spectrum to both detection functions, re-implementing the thin
+ * bookkeeping aubio does around them (peak picking, beat tracking, onset gating) so the
+ * results match the stock objects block for block. Tuning parameters are read from
+ * throwaway aubio tempo/onset objects at creation so they track aubio's defaults.
+ *
+ * Pitch keeps its own `aubio_pitch_t`: yinfft windows and transforms the signal itself and
+ * aubio offers no entry point that accepts a precomputed spectrum.
+ *
+ * All aubio objects are created up front by `create()`; `process()` does not allocate and is
+ * safe to call from the real-time thread.
+ */
+class Analyzer {
+public:
+    [[nodiscard]] static auto create(const AnalysisConfig& config)
+        -> std::expected<Analyzer, std::string> {
+        using namespace aubio_raii;
+
+        Analyzer analyzer {config};
+
+        const auto hop_size    = config.buffer_size;
+        const auto fft_size    = config.fft_size;
+        const auto sample_rate = config.sample_rate;
+
+        // Stock objects, only used to pick up aubio's default tuning
+        const TempoPtr tempo_defaults {new_aubio_tempo("default", fft_size, hop_size, sample_rate)};
+        if (tempo_defaults == nullptr) {
+            return std::unexpected("failed to create aubio tempo");
+        }
+
+        // TODO: not entirely sure these parameters are correct, double check
+        const OnsetPtr onset_defaults {new_aubio_onset("default", fft_size, hop_size, sample_rate)};
+        if (onset_defaults == nullptr) {
+            return std::unexpected("failed to create aubio onset");
+        }
+
+        analyzer.input_vector_.reset(new_fvec(hop_size));
+        analyzer.pvoc_.reset(new_aubio_pvoc(fft_size, hop_size));
+        analyzer.grain_.reset(new_cvec(fft_size));
+        if (analyzer.input_vector_ == nullptr || analyzer.pvoc_ == nullptr
+            || analyzer.grain_ == nullptr) {
+            return std::unexpected("failed to create aubio buffers");
+        }
+
+        // Tempo: spectral flux -> peak picker -> beat tracker, as in new_aubio_tempo()
+        auto& tempo = analyzer.tempo_;
+
+        // Number of detection function samples in 5.8 seconds
+        tempo.window  = std::max(std::bit_ceil(static_cast<std::uint32_t>(
+                                     5.8 * static_cast<double>(sample_rate) / hop_size)),
+                                 4U);
+        tempo.step    = tempo.window / 4U;
+        tempo.silence = aubio_tempo_get_silence(tempo_defaults.get());
+
+        tempo.desc.reset(new_aubio_specdesc("specflux", fft_size));
+        tempo.peaks.reset(new_aubio_peakpicker());
+        tempo.tracker.reset(new_aubio_beattracking(tempo.window, hop_size, sample_rate));
+        tempo.odf.reset(new_fvec(1U));
+        tempo.peak.reset(new_fvec(1U));
+        tempo.frame.reset(new_fvec(tempo.window));
+        tempo.candidates.reset(new_fvec(tempo.step));
+        if (tempo.desc == nullptr || tempo.peaks == nullptr || tempo.tracker == nullptr
+            || tempo.odf == nullptr || tempo.peak == nullptr || tempo.frame == nullptr
+            || tempo.candidates == nullptr) {
+            return std::unexpected("failed to create aubio tempo");
+        }
+        aubio_peakpicker_set_threshold(tempo.peaks.get(),
+                                       aubio_tempo_get_threshold(tempo_defaults.get()));
+
+        // Onset: (whitening/compression) -> default descriptor -> peak picker -> gating
+        auto& onset = analyzer.onset_;
+
+        onset.silence     = aubio_onset_get_silence(onset_defaults.get());
+        onset.min_ioi     = aubio_onset_get_minioi(onset_defaults.get());
+        onset.delay       = aubio_onset_get_delay(onset_defaults.get());
+        onset.compression = aubio_onset_get_compression(onset_defaults.get());
+
+        onset.desc.reset(new_aubio_specdesc("default", fft_size));
+        onset.peaks.reset(new_aubio_peakpicker());
+        onset.odf.reset(new_fvec(1U));
+        onset.peak.reset(new_fvec(1U));
+        if (onset.desc == nullptr || onset.peaks == nullptr || onset.odf == nullptr
+            || onset.peak == nullptr) {
+            return std::unexpected("failed to create aubio onset");
+        }
+        aubio_peakpicker_set_threshold(onset.peaks.get(),
+                                       aubio_onset_get_threshold(onset_defaults.get()));
+
+        if (aubio_onset_get_awhitening(onset_defaults.get()) != 0U) {
+            onset.whitening.reset(new_aubio_spectral_whitening(fft_size, hop_size, sample_rate));
+            if (onset.whitening == nullptr) {
+                return std::unexpected("failed to create aubio onset");
+            }
+        }
+
+        // Whitening and compression modify the spectrum in place, so onset needs its own copy
+        if (onset.whitening != nullptr || onset.compression > 0.0F) {
+            onset.grain.reset(new_cvec(fft_size));
+            if (onset.grain == nullptr) {
+                return std::unexpected("failed to create aubio buffers");
+            }
+        }
+
+        if (config.pitch_enabled) {
+            analyzer.pitch_.reset(new_aubio_pitch("default", fft_size, hop_size, sample_rate));
+            analyzer.pitch_buffer_.reset(new_fvec(1U));
+
+            if (analyzer.pitch_ == nullptr || analyzer.pitch_buffer_ == nullptr) {
+                return std::unexpected("failed to create aubio pitch");
+            }
+            aubio_pitch_set_unit(analyzer.pitch_.get(), "Hz");
+        }
+
+        return analyzer;
+    }
+
+    [[nodiscard]] auto config() const noexcept -> const AnalysisConfig& {
+        return config_;
+    }
+
+    // Current tempo estimate of the beat tracker
+    [[nodiscard]] auto bpm() const noexcept -> float {
+        return aubio_beattracking_get_bpm(tempo_.tracker.get());
+    }
+
+    // How consistent the tracked beat period is, 0 until the tracker has locked on
+    [[nodiscard]] auto confidence() const noexcept -> float {
+        return aubio_beattracking_get_confidence(tempo_.tracker.get());
+    }
+
+    // `block` must hold exactly `config().buffer_size` samples
+    [[nodiscard]] auto process(std::span<const float> block) noexcept -> BlockResult {
+        // aubio only reads its input, so a well-formed block is analyzed where it lies (usually
+        // the mapped PipeWire buffer); the owned input vector is the fallback
+        const aubio_raii::FVecView view {block};
+        const fvec_t*              input = view.get();
+        if (!isWholeBlock(block)) {
+            const trace::Scope probe {"copy"};
+            std::ranges::copy(block.first(std::min<std::size_t>(block.size(), config_.buffer_size)),
+                              fvec_get_data(input_vector_.get()));
+            input = input_vector_.get();
+        }
+
+        // The one window + FFT shared by tempo and onset
+        {
+            const trace::Scope probe {"pvoc"};
+            aubio_pvoc_do(pvoc_.get(), input, grain_.get());
+        }
+
+        float tactus = 0.0F;
+        {
+            const trace::Scope probe {"tempo"};
+            tactus = trackTempo(input);
+        }
+
+        bool is_onset = false;
+        {
+            const trace::Scope probe {"onset"};
+            is_onset = detectOnset(input);
+        }
+
+        const bool is_beat  = tactus > 0.0F;
+        float      pitch_hz = 0.0F;
+        if (pitch_ != nullptr) {
+            const trace::Scope probe {"pitch"};
+            aubio_pitch_do(pitch_.get(), input, pitch_buffer_.get());
+            pitch_hz = pitch_buffer_->data[0];
+        }
+
+        total_frames_ += config_.buffer_size;
+
+        return BlockResult {
+            .is_beat     = is_beat,
+            .is_onset    = is_onset,
+            .pitch_hz    = pitch_hz,
+            .beat_offset = static_cast<std::uint32_t>(
+                std::lround(tactus * static_cast<float>(config_.buffer_size)))};
+    }
+
+private:
+    struct TempoStage {
+        aubio_raii::SpecDescPtr     desc {nullptr};
+        aubio_raii::PeakPickerPtr   peaks {nullptr};
+        aubio_raii::BeatTrackingPtr tracker {nullptr};
+        aubio_raii::FVecPtr         odf {nullptr};         // detection function of this hop
+        aubio_raii::FVecPtr         peak {nullptr};        // peak picker output (unused)
+        aubio_raii::FVecPtr         frame {nullptr};       // thresholded detection function
+        aubio_raii::FVecPtr         candidates {nullptr};  // predicted beat positions
+
+        std::uint32_t window {0U};
+        std::uint32_t step {0U};
+        std::int32_t  block_pos {0};
+        float         silence {0.0F};
+    };
+
+    struct OnsetStage {
+        aubio_raii::SpecDescPtr   desc {nullptr};
+        aubio_raii::PeakPickerPtr peaks {nullptr};
+        aubio_raii::WhiteningPtr  whitening {nullptr};
+        aubio_raii::CVecPtr       grain {nullptr};  // private spectrum copy, if it gets modified
+        aubio_raii::FVecPtr       odf {nullptr};
+        aubio_raii::FVecPtr       peak {nullptr};
+
+        std::uint32_t min_ioi {0U};
+        std::uint32_t delay {0U};
+        std::uint32_t last_onset {0U};
+        float         silence {0.0F};
+        float         compression {0.0F};
+    };
+
+    explicit Analyzer(const AnalysisConfig& config) noexcept
+        : config_(config) {}
+
+    // Only the length matters: aubio reads its input one float at a time, so any span of floats
+    // can back an fvec_t
+    [[nodiscard]] auto isWholeBlock(std::span<const float> block) const noexcept -> bool {
+        return block.size() == config_.buffer_size;
+    }
+
+    // Mirrors aubio_tempo_do() on the shared spectrum. Returns where in the hop the beat fell as
+    // a fraction of it, 0 when there is none.
+    [[nodiscard]] auto trackTempo(const fvec_t* input) noexcept -> float {
+        auto&      tempo = tempo_;
+        const auto frame = std::span {tempo.frame->data, tempo.window};
+
+        aubio_specdesc_do(tempo.desc.get(), grain_.get(), tempo.odf.get());
+
+        // Every `step` hops, re-run the beat tracker over the detection function window
+        if (tempo.block_pos == static_cast<std::int32_t>(tempo.step) - 1) {
+            aubio_beattracking_do(tempo.tracker.get(), tempo.frame.get(), tempo.candidates.get());
+            std::ranges::copy(frame.subspan(tempo.step), frame.begin());
+            std::ranges::fill(frame.last(tempo.step), 0.0F);
+            tempo.block_pos = -1;
+        }
+        ++tempo.block_pos;
+
+        aubio_peakpicker_do(tempo.peaks.get(), tempo.odf.get(), tempo.peak.get());
+        const auto* thresholded = aubio_peakpicker_get_thresholded_input(tempo.peaks.get());
+        frame[tempo.window - tempo.step + static_cast<std::uint32_t>(tempo.block_pos)] =
+            thresholded->data[0];
+
+        // candidates[0] holds the number of predictions + 1, followed by their positions
+        const auto candidates = std::span {tempo.candidates->data, tempo.step};
+        const auto count      = std::min(static_cast<std::uint32_t>(candidates[0]), tempo.step);
+
+        float tactus = 0.0F;
+        for (const float candidate : candidates.subspan(1U, count > 1U ? count - 1U : 0U)) {
+            if (static_cast<std::int32_t>(std::floor(candidate)) == tempo.block_pos) {
+                tactus = candidate - std::floor(candidate);
+                if (aubio_silence_detection(input, tempo.silence) == 1U) {
+                    tactus = 0.0F;
+                }
+            }
+        }
+
+        // Like aubio, a beat predicted exactly on the hop boundary (tactus == 0) is not reported
+        return tactus;
+    }
+
+    // Mirrors aubio_onset_do() on the shared spectrum
+    [[nodiscard]] auto detectOnset(const fvec_t* input) noexcept -> bool {
+        auto&   onset = onset_;
+        cvec_t* grain = grain_.get();
+
+        if (onset.grain != nullptr) {
+            cvec_copy(grain_.get(), onset.grain.get());
+            grain = onset.grain.get();
+
+            if (onset.whitening != nullptr) {
+                aubio_spectral_whitening_do(onset.whitening.get(), grain);
+            }
+            if (onset.compression > 0.0F) {
+                cvec_logmag(grain, onset.compression);
+            }
+        }
+
+        aubio_specdesc_do(onset.desc.get(), grain, onset.odf.get());
+        aubio_peakpicker_do(onset.peaks.get(), onset.odf.get(), onset.peak.get());
+
+        const auto hop_size = config_.buffer_size;
+        const bool silent   = aubio_silence_detection(input, onset.silence) == 1U;
+        float      position = onset.peak->data[0];
+
+        if (position > 0.0F) {
+            if (silent) {
+                position = 0.0F;
+            } else {
+                const auto offset    = std::lround(position * static_cast<float>(hop_size));
+                const auto new_onset = total_frames_ + static_cast<std::uint32_t>(offset);
+
+                // Enforce the minimum inter-onset interval
+                if (onset.last_onset + onset.min_ioi < new_onset) {
+                    // Start of stream: make sure (new_onset - delay) >= 0
+                    if (onset.last_onset > 0U && onset.delay > new_onset) {
+                        position = 0.0F;
+                    } else {
+                        onset.last_onset = std::max(onset.delay, new_onset);
+                    }
+                } else {
+                    position = 0.0F;
+                }
+            }
+        } else if (total_frames_ <= onset.delay && !silent) {
+            // Sound right at the start of the stream counts as an onset
+            if (total_frames_ == 0U || onset.last_onset + onset.min_ioi < total_frames_) {
+                position         = static_cast<float>(onset.delay / hop_size);
+                onset.last_onset = total_frames_ + onset.delay;
+            }
+        }
+
+        return position > 0.0F;
+    }
+
+    AnalysisConfig config_;
+
+    aubio_raii::FVecPtr input_vector_ {nullptr};  // copy of blocks that cannot be aliased
+    aubio_raii::PvocPtr pvoc_ {nullptr};
+    aubio_raii::CVecPtr grain_ {nullptr};  // spectrum of the current hop, shared by all stages
+
+    TempoStage tempo_ {};
+    OnsetStage onset_ {};
+
+    aubio_raii::PitchPtr pitch_ {nullptr};
+    aubio_raii::FVecPtr  pitch_buffer_ {nullptr};
+
+    // Same unit and wrap-around as aubio's own uint_t frame counters
+    std::uint32_t total_frames_ {0U};
+};
+
+}  // namespace beat
@@ -1,12 +1,22 @@
 module;
 #include <aubio/types.h>
 
+// peakpicker and beattracking are only exposed by aubio.h when AUBIO_UNSTABLE is set
+#define AUBIO_UNSTABLE 1
+
+#include <aubio/cvec.h>
 #include <aubio/fvec.h>
 #include <aubio/onset/onset.h>
+#include <aubio/onset/peakpicker.h>
 #include <aubio/pitch/pitch.h>
+#include <aubio/spectral/awhitening.h>
+#include <aubio/spectral/phasevoc.h>
+#include <aubio/spectral/specdesc.h>
+#include <aubio/tempo/beattracking.h>
 #include <aubio/tempo/tempo.h>
 
 #include <memory>
+#include <span>
 
 export module beat.detector:aubio_raii;
 
@@ -44,9 +54,84 @@ struct PitchDeleter {
     }
 };
 
-using TempoPtr = std::unique_ptr<aubio_tempo_t, TempoDeleter>;
-using FVecPtr  = std::unique_ptr<fvec_t, FVecDeleter>;
-using OnsetPtr = std::unique_ptr<aubio_onset_t, OnsetDeleter>;
-using PitchPtr = std::unique_ptr<aubio_pitch_t, PitchDeleter>;
+struct CVecDeleter {
+    void operator()(cvec_t* vec) const noexcept {
+        if (vec != nullptr) {
+            del_cvec(vec);
+        }
+    }
+};
+
+struct PvocDeleter {
+    void operator()(aubio_pvoc_t* pvoc) const noexcept {
+        if (pvoc != nullptr) {
+            del_aubio_pvoc(pvoc);
+        }
+    }
+};
+
+struct SpecDescDeleter {
+    void operator()(aubio_specdesc_t* specdesc) const noexcept {
+        if (specdesc != nullptr) {
+            del_aubio_specdesc(specdesc);
+        }
+    }
+};
+
+struct PeakPickerDeleter {
+    void operator()(aubio_peakpicker_t* peakpicker) const noexcept {
+        if (peakpicker != nullptr) {
+            del_aubio_peakpicker(peakpicker);
+        }
+    }
+};
+
+struct BeatTrackingDeleter {
+    void operator()(aubio_beattracking_t* beattracking) const noexcept {
+        if (beattracking != nullptr) {
+            del_aubio_beattracking(beattracking);
+        }
+    }
+};
+
+struct WhiteningDeleter {
+    void operator()(aubio_spectral_whitening_t* whitening) const noexcept {
+        if (whitening != nullptr) {
+            del_aubio_spectral_whitening(whitening);
+        }
+    }
+};
+
+/*
+ * Non-owning fvec_t over caller memory.
+ *
+ * Lets sample buffers that already exist (a PipeWire mapping, an accumulator block) be handed to
+ * aubio's read-only inputs without a copy. Only ever pass `get()` where aubio takes a
+ * `const fvec_t*`; the const_cast below is sound only because aubio never writes through those.
+ */
+class FVecView {
+public:
+    explicit FVecView(std::span<const smpl_t> samples) noexcept
+        : vec_ {.length = static_cast<uint_t>(samples.size()),
+                .data   = const_cast<smpl_t*>(samples.data())} {}
+
+    [[nodiscard]] auto get() const noexcept -> const fvec_t* {
+        return &vec_;
+    }
+
+private:
+    fvec_t vec_;
+};
+
+using TempoPtr        = std::unique_ptr<aubio_tempo_t, TempoDeleter>;
+using FVecPtr         = std::unique_ptr<fvec_t, FVecDeleter>;
+using OnsetPtr        = std::unique_ptr<aubio_onset_t, OnsetDeleter>;
+using PitchPtr        = std::unique_ptr<aubio_pitch_t, PitchDeleter>;
+using CVecPtr         = std::unique_ptr<cvec_t, CVecDeleter>;
+using PvocPtr         = std::unique_ptr<aubio_pvoc_t, PvocDeleter>;
+using SpecDescPtr     = std::unique_ptr<aubio_specdesc_t, SpecDescDeleter>;
+using PeakPickerPtr   = std::unique_ptr<aubio_peakpicker_t, PeakPickerDeleter>;
+using BeatTrackingPtr = std::unique_ptr<aubio_beattracking_t, BeatTrackingDeleter>;
+using WhiteningPtr    = std::unique_ptr<aubio_spectral_whitening_t, WhiteningDeleter>;
 
 }  // namespace aubio_raii
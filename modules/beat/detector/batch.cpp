@@ -0,0 +1,103 @@
+module;
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+
+module beat.detector;
+
+import :batch;
+import :offline;
+import support.threadpool;
+
+namespace beat {
+
+namespace {
+
+[[nodiscard]] auto isWav(const std::filesystem::path& path) -> bool {
+    auto extension = path.extension().string();
+    std::ranges::transform(extension, extension.begin(), [](unsigned char character) {
+        return static_cast<char>(std::tolower(character));
+    });
+    return extension == ".wav";
+}
+
+}  // namespace
+
+auto analyzeDirectory(const std::filesystem::path& root,
+                      const BatchOptions&          options,
+                      const BatchSink&             sink)
+    -> std::expected<BatchSummary, std::string> {
+    namespace fs = std::filesystem;
+    using Clock  = std::chrono::steady_clock;
+
+    std::error_code                  walk_error;
+    fs::recursive_directory_iterator walker {
+        root, fs::directory_options::skip_permission_denied, walk_error};
+    if (walk_error) {
+        return std::unexpected(std::format("{}: {}", root.string(), walk_error.message()));
+    }
+
+    const auto   start = Clock::now();
+    BatchSummary summary {};
+    std::mutex   summary_mutex;
+
+    {
+        threadpool::Pool pool {options.jobs};
+        summary.jobs = pool.workerCount();
+
+        // Decode buffers live as long as the pool and are reused by every file on that worker
+        std::vector<OfflineScratch> scratch(pool.workerCount());
+
+        for (; walker != fs::end(walker); walker.increment(walk_error)) {
+            if (walk_error) {
+                break;
+            }
+
+            std::error_code entry_error;
+            if (!walker->is_regular_file(entry_error) || !isWav(walker->path())) {
+                continue;
+            }
+
+            pool.submit([&, path = walker->path()](std::size_t worker) {
+                BatchResult result {.path = path, .report = std::unexpected(std::string {})};
+                try {
+                    result.report = analyzeFile(path, options.analysis, {}, scratch[worker]);
+                } catch (const std::exception& exception) {
+                    result.report = std::unexpected(std::string {exception.what()});
+                }
+
+                const std::scoped_lock lock {summary_mutex};
+                ++summary.files;
+                if (result.report) {
+                    summary.audio_seconds += result.report->audio_seconds;
+                } else {
+                    ++summary.failed;
+                }
+
+                if (sink) {
+                    sink(result);
+                }
+            });
+        }
+
+        pool.wait();
+    }
+
+    if (walk_error) {
+        return std::unexpected(std::format("{}: {}", root.string(), walk_error.message()));
+    }
+
+    summary.elapsed_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return summary;
+}
+
+}  // namespace beat
@@ -0,0 +1,44 @@
+module;
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+export module beat.detector:batch;
+
+import :offline;
+
+export namespace beat {
+
+struct BatchOptions {
+    OfflineOptions analysis {};
+    std::size_t    jobs {0U};  // 0 = one worker per hardware thread
+};
+
+struct BatchResult {
+    std::filesystem::path                     path;
+    std::expected<OfflineReport, std::string> report;
+};
+
+struct BatchSummary {
+    std::size_t   jobs {0U};
+    std::uint64_t files {0U};
+    std::uint64_t failed {0U};
+    double        audio_seconds {0.0};
+    double        elapsed_seconds {0.0};
+};
+
+// Called once per file, from the worker threads but never concurrently, in completion order
+using BatchSink = std::function<void(const BatchResult&)>;
+
+// Analyzes every .wav file below `root` on a work-stealing pool. Each file is streamed through
+// its own analyzer on a single worker, so throughput scales with the number of jobs while
+// memory stays at a few chunks per worker regardless of file length.
+[[nodiscard]] auto analyzeDirectory(const std::filesystem::path& root,
+                                    const BatchOptions&          options,
+                                    const BatchSink&             sink)
+    -> std::expected<BatchSummary, std::string>;
+
+}  // namespace beat
@@ -0,0 +1,282 @@
+module;
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <format>
+#include <memory>
+#include <new>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+module beat.detector;
+
+import :clock;
+
+namespace beat {
+
+namespace {
+
+// shm_open wants exactly one leading slash and no other
+[[nodiscard]] auto shmName(std::string_view name) -> std::expected<std::string, std::string> {
+    if (name.starts_with('/')) {
+        name.remove_prefix(1U);
+    }
+    if (name.empty() || name.contains('/') || name.size() > 250U) {
+        return std::unexpected(std::format("invalid shared memory name '{}'", name));
+    }
+    return std::format("/{}", name);
+}
+
+[[nodiscard]] constexpr auto segmentSize(std::size_t streams) noexcept -> std::size_t {
+    return ClockHeader::kSlotsOffset + (streams * sizeof(ClockSlot));
+}
+
+struct FdGuard {
+    int file_descriptor;
+    ~FdGuard() {
+        if (file_descriptor >= 0) {
+            ::close(file_descriptor);
+        }
+    }
+
+    // Hands the descriptor over to its next owner
+    [[nodiscard]] auto release() noexcept -> int {
+        return std::exchange(file_descriptor, -1);
+    }
+};
+
+// A live writer holds an exclusive flock on its segment for as long as it exists
+[[nodiscard]] auto lockSegment(int file_descriptor) noexcept -> bool {
+    return ::flock(file_descriptor, LOCK_EX | LOCK_NB) == 0;
+}
+
+[[nodiscard]] auto inUse(const std::string& shm_name) -> std::string {
+    return std::format("{}: {} (in use by another detector)", shm_name, std::strerror(EEXIST));
+}
+
+// Whether `shm_name` still names the segment open as `file_descriptor`
+[[nodiscard]] auto namesSegment(const std::string& shm_name, int file_descriptor) noexcept
+    -> bool {
+    const int named = ::shm_open(shm_name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (named < 0) {
+        return false;
+    }
+    const FdGuard guard {named};
+
+    struct stat ours {};
+    struct stat current {};
+    return ::fstat(file_descriptor, &ours) == 0 && ::fstat(named, &current) == 0
+           && ours.st_dev == current.st_dev && ours.st_ino == current.st_ino;
+}
+
+/*
+ * Creates the segment exclusively and locks it. One of the same name that nobody holds the lock
+ * of was left behind by a writer that died without unlinking it, and is replaced; one that is
+ * still locked belongs to a running detector and is left alone.
+ *
+ * A segment is unlocked for a moment between its creation and its lock, so another detector
+ * may take it for stale and unlink it in between. Once locked, the name is checked to still
+ * lead to our segment, and the creation retried if it does not.
+ */
+[[nodiscard]] auto createSegment(const std::string& shm_name) -> std::expected<int, std::string> {
+    constexpr int kAttempts = 4;
+
+    for (int attempt = 0; attempt < kAttempts; ++attempt) {
+        const int file_descriptor =
+            ::shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (file_descriptor >= 0) {
+            FdGuard guard {file_descriptor};
+            if (!lockSegment(file_descriptor)) {
+                return std::unexpected(inUse(shm_name));
+            }
+            if (!namesSegment(shm_name, file_descriptor)) {
+                continue;  // unlinked before we locked it, the name may be free again
+            }
+            return guard.release();
+        }
+        if (errno != EEXIST) {
+            return std::unexpected(std::format("{}: {}", shm_name, std::strerror(errno)));
+        }
+
+        const int existing = ::shm_open(shm_name.c_str(), O_RDWR | O_CLOEXEC, 0);
+        if (existing < 0) {
+            if (errno == ENOENT) {
+                continue;  // unlinked meanwhile
+            }
+            return std::unexpected(std::format("{}: {}", shm_name, std::strerror(errno)));
+        }
+        const FdGuard guard {existing};
+        if (!lockSegment(existing)) {
+            return std::unexpected(inUse(shm_name));
+        }
+
+        // Readers still mapping the stale segment keep it until they let go. It may have been
+        // replaced already by a detector that locked it before us.
+        if (namesSegment(shm_name, existing)) {
+            (void) ::shm_unlink(shm_name.c_str());
+        }
+    }
+
+    return std::unexpected(inUse(shm_name));
+}
+
+}  // namespace
+
+ClockWriter::ClockWriter(std::string name,
+                         int         file_descriptor,
+                         void*       mapping,
+                         std::size_t size) noexcept
+    : name_(std::move(name))
+    , file_descriptor_(file_descriptor)
+    , mapping_(mapping)
+    , size_(size) {}
+
+auto ClockWriter::create(std::string_view name, std::size_t streams)
+    -> std::expected<std::unique_ptr<ClockWriter>, std::string> {
+    auto shm_name = shmName(name);
+    if (!shm_name) {
+        return std::unexpected(shm_name.error());
+    }
+
+    const auto created = createSegment(*shm_name);
+    if (!created) {
+        return std::unexpected(created.error());
+    }
+    const int file_descriptor = *created;
+    FdGuard   guard {file_descriptor};
+
+    const auto size = segmentSize(streams);
+    if (::ftruncate(file_descriptor, static_cast<off_t>(size)) != 0) {
+        const int error = errno;
+        (void) ::shm_unlink(shm_name->c_str());
+        return std::unexpected(std::format("{}: {}", *shm_name, std::strerror(error)));
+    }
+
+    // Populated up front so the RT thread never takes a page fault on its first beat
+    void* mapping = ::mmap(
+        nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, file_descriptor, 0);
+    if (mapping == MAP_FAILED) {
+        const int error = errno;
+        (void) ::shm_unlink(shm_name->c_str());
+        return std::unexpected(std::format("{}: {}", *shm_name, std::strerror(error)));
+    }
+
+    // Not make_unique: the constructor is private. The writer keeps the descriptor, and with
+    // it the lock, for as long as it exists.
+    std::unique_ptr<ClockWriter> writer {
+        new ClockWriter {std::move(*shm_name), guard.release(), mapping, size}};
+
+    auto* bytes = static_cast<std::byte*>(mapping);
+    auto* slots = reinterpret_cast<ClockSlot*>(bytes + ClockHeader::kSlotsOffset);
+    std::uninitialized_value_construct_n(slots, streams);
+    writer->slots_ = std::span {slots, streams};
+
+    // The magic goes in last, readers reject the segment until it is fully set up
+    auto* header = new (bytes) ClockHeader {.magic     = {},
+                                            .version   = ClockHeader::kVersion,
+                                            .slot_size = sizeof(ClockSlot),
+                                            .streams   = static_cast<std::uint32_t>(streams)};
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = ClockHeader::kMagic;
+
+    return writer;
+}
+
+ClockWriter::~ClockWriter() {
+    if (mapping_ != nullptr) {
+        ::munmap(mapping_, size_);
+    }
+
+    // The name may have been taken over since, by a detector that found this one stale
+    if (namesSegment(name_, file_descriptor_)) {
+        (void) ::shm_unlink(name_.c_str());
+    }
+    ::close(file_descriptor_);
+}
+
+ClockReader::ClockReader(void* mapping, std::size_t size, std::size_t streams) noexcept
+    : mapping_(mapping)
+    , size_(size)
+    , slots_(reinterpret_cast<const ClockSlot*>(static_cast<const std::byte*>(mapping)
+                                                + ClockHeader::kSlotsOffset),
+             streams) {}
+
+ClockReader::ClockReader(ClockReader&& other) noexcept
+    : mapping_(std::exchange(other.mapping_, nullptr))
+    , size_(std::exchange(other.size_, 0U))
+    , slots_(std::exchange(other.slots_, {})) {}
+
+auto ClockReader::operator=(ClockReader&& other) noexcept -> ClockReader& {
+    if (this != &other) {
+        unmap();
+        mapping_ = std::exchange(other.mapping_, nullptr);
+        size_    = std::exchange(other.size_, 0U);
+        slots_   = std::exchange(other.slots_, {});
+    }
+    return *this;
+}
+
+ClockReader::~ClockReader() {
+    unmap();
+}
+
+void ClockReader::unmap() noexcept {
+    if (mapping_ != nullptr) {
+        ::munmap(mapping_, size_);
+        mapping_ = nullptr;
+        size_    = 0U;
+        slots_   = {};
+    }
+}
+
+auto ClockReader::open(std::string_view name) -> std::expected<ClockReader, std::string> {
+    const auto shm_name = shmName(name);
+    if (!shm_name) {
+        return std::unexpected(shm_name.error());
+    }
+
+    const int file_descriptor = ::shm_open(shm_name->c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (file_descriptor < 0) {
+        return std::unexpected(std::format("{}: {}", *shm_name, std::strerror(errno)));
+    }
+    const FdGuard guard {file_descriptor};
+
+    struct stat segment_stat {};
+    if (::fstat(file_descriptor, &segment_stat) != 0
+        || static_cast<std::size_t>(segment_stat.st_size) < ClockHeader::kSlotsOffset) {
+        return std::unexpected(std::format("{}: not a beat clock", *shm_name));
+    }
+
+    const auto size    = static_cast<std::size_t>(segment_stat.st_size);
+    void*      mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    if (mapping == MAP_FAILED) {
+        return std::unexpected(std::format("{}: {}", *shm_name, std::strerror(errno)));
+    }
+
+    // Magic first: the rest of the header is only meaningful once it is in place
+    ClockHeader header {};
+    std::memcpy(&header.magic, mapping, sizeof(header.magic));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    std::memcpy(&header, mapping, sizeof(header));
+
+    if (header.magic != ClockHeader::kMagic || header.version != ClockHeader::kVersion
+        || header.slot_size != sizeof(ClockSlot) || segmentSize(header.streams) > size) {
+        ::munmap(mapping, size);
+        return std::unexpected(std::format("{}: not a compatible beat clock", *shm_name));
+    }
+
+    return ClockReader {mapping, size, header.streams};
+}
+
+}  // namespace beat
@@ -0,0 +1,123 @@
+module;
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+export module beat.detector:clock;
+
+import support.seqlock;
+
+export namespace beat {
+
+// One stream's beat clock as published in the shared segment. Times are CLOCK_MONOTONIC
+// nanoseconds, the clock PipeWire itself schedules the graph with.
+struct ClockRecord {
+    float         bpm {0.0F};
+    float         confidence {0.0F};
+    std::uint64_t beats {0U};
+    std::uint64_t last_beat_ns {0U};
+    std::uint64_t next_beat_ns {0U};  // one period at `bpm` after the last beat, 0 until known
+};
+
+// Start of the segment; the per-stream slots follow at kSlotsOffset
+struct ClockHeader {
+    static constexpr std::array<char, 8> kMagic {'B', 'E', 'A', 'T', 'C', 'L', 'K', '\0'};
+    static constexpr std::uint32_t       kVersion     = 1U;
+    static constexpr std::size_t         kSlotsOffset = 64U;
+
+    std::array<char, 8> magic {kMagic};
+    std::uint32_t       version {kVersion};
+    std::uint32_t       slot_size {0U};
+    std::uint32_t       streams {0U};
+};
+
+// One cache line per stream, so streams written from different quanta do not share one
+struct alignas(64) ClockSlot {
+    seqlock::SeqLock<ClockRecord> record;
+};
+
+static_assert(sizeof(ClockHeader) <= ClockHeader::kSlotsOffset);
+
+/*
+ * Shared-memory beat clock, one seqlocked record per capture stream.
+ *
+ * The detector maps a POSIX shm segment (`/dev/shm/<name>`) and publishes every beat into it
+ * straight from the RT thread: a handful of relaxed stores, no syscalls and no wakeups, so the
+ * cost does not grow with the number of readers. Readers map the same segment read-only and
+ * load records without any syscall or round-trip to the detector.
+ */
+class ClockWriter {
+public:
+    // `name` as given to shm_open, with or without the leading '/'. A stale segment of the
+    // same name left behind by a crashed detector is replaced; one a running detector still
+    // holds is an error.
+    [[nodiscard]] static auto create(std::string_view name, std::size_t streams)
+        -> std::expected<std::unique_ptr<ClockWriter>, std::string>;
+
+    ClockWriter(const ClockWriter&)                    = delete;
+    auto operator=(const ClockWriter&) -> ClockWriter& = delete;
+    ClockWriter(ClockWriter&&)                         = delete;
+    auto operator=(ClockWriter&&) -> ClockWriter&      = delete;
+
+    // Unmaps and unlinks the segment, if the name is still ours; readers keep their mapping
+    // until they drop it
+    ~ClockWriter();
+
+    // RT safe and wait-free, one writer per stream
+    void publish(std::size_t stream, const ClockRecord& record) noexcept {
+        if (stream < slots_.size()) {
+            slots_[stream].record.store(record);
+        }
+    }
+
+    [[nodiscard]] auto name() const noexcept -> std::string_view {
+        return name_;
+    }
+
+private:
+    ClockWriter(std::string name, int file_descriptor, void* mapping, std::size_t size) noexcept;
+
+    std::string          name_;
+    int                  file_descriptor_ {-1};  // holds the owner lock
+    void*                mapping_ {nullptr};
+    std::size_t          size_ {0U};
+    std::span<ClockSlot> slots_;
+};
+
+// Reading side, for any process on the machine
+class ClockReader {
+public:
+    [[nodiscard]] static auto open(std::string_view name)
+        -> std::expected<ClockReader, std::string>;
+
+    ClockReader(const ClockReader&)                    = delete;
+    auto operator=(const ClockReader&) -> ClockReader& = delete;
+    ClockReader(ClockReader&& other) noexcept;
+    auto operator=(ClockReader&& other) noexcept -> ClockReader&;
+    ~ClockReader();
+
+    [[nodiscard]] auto streams() const noexcept -> std::size_t {
+        return slots_.size();
+    }
+
+    // No syscalls; retries only while the detector is mid-store
+    [[nodiscard]] auto read(std::size_t stream = 0U) const noexcept -> ClockRecord {
+        return stream < slots_.size() ? slots_[stream].record.load() : ClockRecord {};
+    }
+
+private:
+    ClockReader(void* mapping, std::size_t size, std::size_t streams) noexcept;
+
+    void unmap() noexcept;
+
+    void*                      mapping_ {nullptr};
+    std::size_t                size_ {0U};
+    std::span<const ClockSlot> slots_;
+};
+
+}  // namespace beat
@@ -0,0 +1,216 @@
+module;
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <print>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+module beat.detector;
+
+import :analysis;
+import :event_log;
+
+namespace beat {
+
+namespace {
+
+// Records read per chunk when converting
+constexpr std::size_t kConvertChunk = 4096U;
+
+[[nodiscard]] auto nanosSinceEpoch(auto time_point) noexcept -> std::int64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time_point.time_since_epoch())
+        .count();
+}
+
+}  // namespace
+
+auto EventLogWriter::open(const std::filesystem::path& path)
+    -> std::expected<std::unique_ptr<EventLogWriter>, std::string> {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return std::unexpected(std::format("{}: {}", path.string(), std::strerror(errno)));
+    }
+
+    // Not make_unique: the constructor is private
+    std::unique_ptr<EventLogWriter> writer {new EventLogWriter {fd}};
+
+    const LogHeader header {.wall_ns      = nanosSinceEpoch(std::chrono::system_clock::now()),
+                            .monotonic_ns = nanosSinceEpoch(std::chrono::steady_clock::now())};
+    if (!writer->writeAll(std::as_bytes(std::span {&header, 1U}))) {
+        return std::unexpected(std::format("{}: failed to write header", path.string()));
+    }
+
+    writer->writer_ = std::jthread {[raw = writer.get()](const std::stop_token& stop_token) {
+        raw->run(stop_token);
+    }};
+
+    return writer;
+}
+
+EventLogWriter::~EventLogWriter() {
+    if (writer_.joinable()) {
+        writer_.request_stop();
+        writer_.join();
+    }
+
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void EventLogWriter::append(const Event& event) noexcept {
+    const auto flags = static_cast<std::uint16_t>((event.is_beat ? LogRecord::kBeat : 0U)
+                                                  | (event.is_onset ? LogRecord::kOnset : 0U));
+
+    (void)queue_.tryPush(LogRecord {.timestamp_ns = event.timestamp_ns,
+                                    .flags        = flags,
+                                    .stream       = static_cast<std::uint16_t>(event.stream),
+                                    .bpm          = event.bpm,
+                                    .pitch_hz     = event.pitch_hz,
+                                    .process_ms   = static_cast<float>(event.process_ms)});
+}
+
+void EventLogWriter::commit() noexcept {
+    published_.fetch_add(1U, std::memory_order_release);
+    published_.notify_one();
+}
+
+void EventLogWriter::run(const std::stop_token& stop_token) noexcept {
+    const std::stop_callback wake_on_stop {stop_token, [this] { commit(); }};
+
+    auto seen = published_.load(std::memory_order_acquire);
+    while (!stop_token.stop_requested()) {
+        flush();
+        // Returns immediately if a commit landed after the flush above
+        published_.wait(seen, std::memory_order_acquire);
+        seen = published_.load(std::memory_order_acquire);
+    }
+
+    flush();
+}
+
+void EventLogWriter::flush() noexcept {
+    for (;;) {
+        std::size_t count = 0U;
+        while (count < batch_.size()) {
+            const auto record = queue_.tryPop();
+            if (!record) {
+                break;
+            }
+            batch_[count++] = *record;
+        }
+
+        if (count == 0U) {
+            return;
+        }
+
+        if (!writeAll(std::as_bytes(std::span {batch_}.first(count)))) {
+            write_errors_.fetch_add(1U, std::memory_order_relaxed);
+        }
+    }
+}
+
+auto EventLogWriter::writeAll(std::span<const std::byte> bytes) noexcept -> bool {
+    while (!bytes.empty()) {
+        const auto written = ::write(fd_, bytes.data(), bytes.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes = bytes.subspan(static_cast<std::size_t>(written));
+    }
+
+    return true;
+}
+
+auto convertEventLog(const std::filesystem::path& input, const std::filesystem::path& output)
+    -> std::expected<std::uint64_t, std::string> {
+    std::ifstream in {input, std::ios::binary};
+    if (!in) {
+        return std::unexpected(std::format("{}: failed to open", input.string()));
+    }
+
+    LogHeader header {};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || header.magic != LogHeader::kMagic) {
+        return std::unexpected(std::format("{}: not a beat event log", input.string()));
+    }
+    // Version 1 differs only in the stream field, which it always left zero
+    if (header.version == 0U || header.version > LogHeader::kVersion
+        || header.record_size != sizeof(LogRecord)) {
+        return std::unexpected(
+            std::format("{}: unsupported log version {}", input.string(), header.version));
+    }
+
+    std::ofstream out {output, std::ios::out | std::ios::trunc};
+    if (!out) {
+        return std::unexpected(std::format("{}: failed to open", output.string()));
+    }
+
+    using namespace std::chrono;
+
+    const auto to_wall = [&](std::int64_t monotonic_ns) {
+        return sys_time<nanoseconds> {nanoseconds {header.wall_ns + monotonic_ns
+                                                   - header.monotonic_ns}};
+    };
+
+    std::println(out,
+                 "# Beat Detection Log - {:%F %T}",
+                 floor<seconds>(to_wall(header.monotonic_ns)));
+    std::println(out, "# Timestamp,BPM,Onset,Pitch(Hz),ProcessTime(ms),Stream");
+
+    std::vector<LogRecord> chunk(kConvertChunk);
+    std::uint64_t          converted = 0U;
+
+    for (;;) {
+        in.read(reinterpret_cast<char*>(chunk.data()),
+                static_cast<std::streamsize>(chunk.size() * sizeof(LogRecord)));
+        // A torn trailing record (killed mid-write) is ignored
+        const auto records = static_cast<std::size_t>(in.gcount()) / sizeof(LogRecord);
+
+        for (const auto& record : std::span {chunk}.first(records)) {
+            const auto wall   = to_wall(static_cast<std::int64_t>(record.timestamp_ns));
+            const auto second = floor<seconds>(wall);
+            const bool beat   = (record.flags & LogRecord::kBeat) != 0U;
+
+            std::println(out,
+                         "{:%T}.{:03},{:.1f},{},{:.3f},{:.3f},{}",
+                         second,
+                         duration_cast<milliseconds>(wall - second).count(),
+                         beat ? record.bpm : 0.0F,
+                         (record.flags & LogRecord::kOnset) != 0U ? 1 : 0,
+                         record.pitch_hz,
+                         record.process_ms,
+                         record.stream);
+        }
+
+        converted += records;
+        if (records < chunk.size()) {
+            break;
+        }
+    }
+
+    if (!out.flush()) {
+        return std::unexpected(std::format("{}: write failed", output.string()));
+    }
+
+    return converted;
+}
+
+}  // namespace beat
@@ -0,0 +1,116 @@
+module;
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+export module beat.detector:event_log;
+
+import :analysis;
+import support.spsc;
+
+namespace beat {
+
+// On-disk record, one per beat/onset event. Timestamps are CLOCK_MONOTONIC nanoseconds and
+// are mapped back to wall-clock time through the anchor in the file header.
+struct LogRecord {
+    static constexpr std::uint16_t kBeat  = 1U << 0U;
+    static constexpr std::uint16_t kOnset = 1U << 1U;
+
+    std::uint64_t timestamp_ns;
+    std::uint16_t flags;
+    std::uint16_t stream;  // capture stream index, version 2 on (always 0 before)
+    float         bpm;
+    float         pitch_hz;
+    float         process_ms;
+};
+
+static_assert(sizeof(LogRecord) == 24U);
+
+struct LogHeader {
+    static constexpr std::array<char, 8> kMagic {'B', 'E', 'A', 'T', 'L', 'O', 'G', '\0'};
+    static constexpr std::uint32_t       kVersion = 2U;
+
+    std::array<char, 8> magic {kMagic};
+    std::uint32_t       version {kVersion};
+    std::uint32_t       record_size {sizeof(LogRecord)};
+    std::int64_t        wall_ns {0};       // system_clock at open
+    std::int64_t        monotonic_ns {0};  // steady_clock at the same instant
+};
+
+static_assert(sizeof(LogHeader) == 32U);
+
+/*
+ * Binary event log written by a dedicated thread, shared by every stream of a detector.
+ *
+ * The mainloop `append()`s fixed-size records into an SPSC ring and `commit()`s once per
+ * drain; the writer thread wakes on that, empties the ring into a batch buffer and issues one
+ * `write` per batch. No formatting or clock reads happen on the producer side, and a stalled
+ * disk only costs dropped records instead of a blocked mainloop.
+ */
+class EventLogWriter {
+public:
+    static constexpr std::size_t kQueueCapacity = 4096U;
+    static constexpr std::size_t kBatchRecords  = 2048U;  // 48 KiB per write
+
+    [[nodiscard]] static auto open(const std::filesystem::path& path)
+        -> std::expected<std::unique_ptr<EventLogWriter>, std::string>;
+
+    EventLogWriter(const EventLogWriter&)                    = delete;
+    auto operator=(const EventLogWriter&) -> EventLogWriter& = delete;
+    EventLogWriter(EventLogWriter&&)                         = delete;
+    auto operator=(EventLogWriter&&) -> EventLogWriter&      = delete;
+
+    // Flushes everything appended so far before returning
+    ~EventLogWriter();
+
+    // Producer side, single thread
+    void append(const Event& event) noexcept;
+    void commit() noexcept;
+
+    [[nodiscard]] auto dropped() const noexcept -> std::uint64_t {
+        return queue_.dropped();
+    }
+
+    [[nodiscard]] auto writeErrors() const noexcept -> std::uint64_t {
+        return write_errors_.load(std::memory_order_relaxed);
+    }
+
+private:
+    explicit EventLogWriter(int fd) noexcept : fd_(fd) {}
+
+    void run(const std::stop_token& stop_token) noexcept;
+    void flush() noexcept;
+    auto writeAll(std::span<const std::byte> bytes) noexcept -> bool;
+
+    int fd_ {-1};
+
+    spsc::Ring<LogRecord, kQueueCapacity> queue_;
+    std::atomic<std::uint32_t>            published_ {0U};
+    std::atomic<std::uint64_t>            write_errors_ {0U};
+
+    // Writer thread only
+    std::array<LogRecord, kBatchRecords> batch_ {};
+
+    std::jthread writer_;
+};
+
+}  // namespace beat
+
+export namespace beat {
+
+// Converts a binary event log into the CSV layout the detector used to write directly.
+// Returns the number of records converted.
+[[nodiscard]] auto convertEventLog(const std::filesystem::path& input,
+                                   const std::filesystem::path& output)
+    -> std::expected<std::uint64_t, std::string>;
+
+}  // namespace beat
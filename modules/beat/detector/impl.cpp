@@ -1,10 +1,5 @@
 module;
-#include <aubio/types.h>
-
-#include <aubio/fvec.h>
-#include <aubio/onset/onset.h>
-#include <aubio/pitch/pitch.h>
-#include <aubio/tempo/tempo.h>
+#include <pipewire/context.h>
 #include <pipewire/core.h>
 #include <pipewire/keys.h>
 #include <pipewire/loop.h>
@@ -15,43 +10,80 @@ module;
 #include <pipewire/stream.h>
 #include <spa/param/audio/format.h>
 #include <spa/param/audio/raw-utils.h>
+#include <spa/param/format-utils.h>
 #include <spa/param/param.h>
 #include <spa/pod/builder.h>
+#include <spa/utils/hook.h>
 
 #include <algorithm>
 #include <atomic>
+#include <bit>
 #include <chrono>
+#include <cmath>
+#include <csignal>
+#include <ctime>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <expected>
 #include <filesystem>
-#include <fstream>
+#include <format>
 #include <iostream>
 #include <memory>
-#include <numeric>
+#include <optional>
 #include <print>
 #include <ranges>
-#include <stop_token>
+#include <span>
+#include <string>
 #include <string_view>
 #include <thread>
+#include <utility>
 #include <vector>
 
 module beat.detector;
 
-import :aubio_raii;
+import :analysis;
+import :clock;
+import :event_log;
 import :pw_raii;
+import :quantum;
 import audio.blocks;
 import support.u8fmt;
 import support.icons;
+import support.trace;
 
 using namespace pw_raii;
-using namespace aubio_raii;
 
 namespace beat {
 
+class Engine;
+
 namespace {
 
-constexpr std::uint32_t kSampleRate = 44100U;  // REVIEW: Configurable?
-constexpr std::uint32_t kChannels   = 1U;
+// Signals are process-wide. SIGINT/SIGTERM normally reach the mainloop through its signalfd;
+// BeatDetector::signalHandler() only flips this and wakes the engine registered below.
+constinit std::atomic_bool     signal_quit {false};
+constinit std::atomic<Engine*> signal_engine {nullptr};
+
+// Writes the trace buffers next to the event logs, named after the current time
+void exportTrace() {
+    const auto now =
+        std::chrono::clock_cast<std::chrono::utc_clock>(std::chrono::system_clock::now());
+    const std::filesystem::path trace_file =
+        std::format("beat_trace_{:%Y%m%d_%H%M%S}Z.json", now);
+
+    if (const auto written = trace::exportChrome(trace_file); written) {
+        std::println("{} Trace: {} events written to {}",
+                     u8fmt::wrapU8string(icons::kStats),
+                     *written,
+                     trace_file.string());
+    } else {
+        std::println(std::cerr,
+                     "{} Trace export failed: {}",
+                     u8fmt::wrapU8string(icons::kFail),
+                     written.error());
+    }
+}
 
 void featureLine(std::string_view label, bool enabled, std::u8string_view icon) {
     auto u8_icon = u8fmt::wrapU8string(icon);
@@ -61,498 +93,886 @@ void featureLine(std::string_view label, bool enabled, std::u8string_view icon)
                enabled ? u8fmt::wrapU8string(icons::kCheck) : u8fmt::wrapU8string(icons::kFail));
 }
 
+[[nodiscard]] auto describe(const RtDiagnostic& diagnostic) -> std::string {
+    switch (diagnostic.kind) {
+        using enum RtDiagnostic::Kind;
+        case BufferRejected:
+            return std::format(
+                "SPA buffer rejected: {}",
+                audio_blocks::toString(static_cast<audio_blocks::ViewError>(diagnostic.code)));
+        case EventDropped:
+            return "Event queue full, beat/onset dropped";
+        case Xrun:
+            return "Xrun: the graph skipped a cycle or the capture delay jumped";
+    }
+    return "Unknown diagnostic";
+}
+
+/*
+ * Mainloop side rate limiting for RT diagnostics. Each distinct diagnostic (kind and code) is
+ * printed at most once per kInterval; repeats in between are only counted, and that count is
+ * attached to the next line printed for it, or reported by flush() once the interval is over.
+ * A flood of identical errors therefore costs one line per second, not one per quantum.
+ */
+class DiagnosticLimiter {
+public:
+    static constexpr auto kInterval = std::chrono::seconds {1};
+
+    // The number of repeats held back since it was last printed, or nothing if this one
+    // should be held back too
+    [[nodiscard]] auto admit(const RtDiagnostic&                 diagnostic,
+                             std::chrono::steady_clock::time_point now) noexcept
+        -> std::optional<std::uint64_t> {
+        const auto kind = std::min<std::size_t>(static_cast<std::size_t>(diagnostic.kind),
+                                                RtDiagnostic::kKinds - 1U);
+        const auto code = std::min<std::size_t>(diagnostic.code, RtDiagnostic::kCodes - 1U);
+        auto&      slot = slots_[(kind * RtDiagnostic::kCodes) + code];
+
+        if (slot.printed && now - slot.last_print < kInterval) {
+            ++slot.suppressed;
+            return std::nullopt;
+        }
+
+        slot.printed    = true;
+        slot.last_print = now;
+        return std::exchange(slot.suppressed, 0U);
+    }
+
+    // Hands the repeats still held back to `report(diagnostic, count)`: those whose interval is
+    // over, or all of them when `everything`, so a flood that stops is still accounted for.
+    // Returns whether any are still held back.
+    template <typename ReportFn>
+    auto flush(std::chrono::steady_clock::time_point now, bool everything, ReportFn&& report)
+        -> bool {
+        bool holding = false;
+        for (std::size_t index = 0U; index < slots_.size(); ++index) {
+            auto& slot = slots_[index];
+            if (slot.suppressed == 0U) {
+                continue;
+            }
+            if (!everything && now - slot.last_print < kInterval) {
+                holding = true;
+                continue;
+            }
+
+            const auto kind = static_cast<RtDiagnostic::Kind>(index / RtDiagnostic::kCodes);
+            const auto code = static_cast<std::uint8_t>(index % RtDiagnostic::kCodes);
+
+            slot.last_print = now;
+            report(RtDiagnostic {.kind = kind, .code = code}, std::exchange(slot.suppressed, 0U));
+        }
+        return holding;
+    }
+
+private:
+    struct Slot {
+        std::chrono::steady_clock::time_point last_print {};
+        std::uint64_t                         suppressed {0U};
+        bool                                  printed {false};
+    };
+
+    std::array<Slot, RtDiagnostic::kKinds * RtDiagnostic::kCodes> slots_ {};
+};
+
 }  // namespace
 
-class DetectorState {
+// Settings shared by every stream of an engine
+struct EngineConfig {
+    std::uint32_t  buffer_size;
+    std::uint32_t  fft_size;
+    CaptureOptions capture;  // CaptureOptions::kGraphRate lets the graph decide the rate
+    bool           log_enabled;
+    bool           stats_enabled;
+    bool           pitch_enabled;
+    bool           visual_enabled;
+};
+
+/*
+ * One capture stream hosted by the engine: its PipeWire stream on the engine's shared core, and
+ * the QuantumProcessor its real-time callback feeds (analyzer, accumulator, event ring, stats).
+ */
+class StreamState {
 public:
-    pw_raii::MainLoopPtr main_loop {nullptr};
-    pw_raii::StreamPtr   stream {nullptr};
-
-    aubio_raii::TempoPtr tempo {nullptr};
-    aubio_raii::FVecPtr  input_vector {nullptr};
-    aubio_raii::FVecPtr  output_vector {nullptr};
-    aubio_raii::OnsetPtr onset {nullptr};
-    aubio_raii::PitchPtr pitch {nullptr};
-    aubio_raii::FVecPtr  pitch_buffer {nullptr};
-
-    // TODO: maybe make this private
-    const std::uint32_t buffer_size;
-    const std::uint32_t fft_size;
-    bool                log_enabled;
-    bool                stats_enabled;
-    bool                pitch_enabled;
-    bool                visual_enabled;
-
-    std::ofstream                         log;
-    std::vector<double>                   processing_times_ms;
-    std::uint64_t                         total_beats {0}, total_onsets {0};
-    std::chrono::steady_clock::time_point start, last_beat;
-    float                                 last_bpm {0.F};
-
-    static constexpr std::size_t kBPMCapacity = 10U;
+    Engine&           engine;
+    const std::size_t index;
+    const StreamSpec  spec;
+
+    pw_raii::StreamPtr stream {nullptr};
+    spa_hook           listener {};
+
+    // The per-quantum work, fed from onProcess()
+    QuantumProcessor quantum;
 
     /*
-     * Real-time (RT) -> Mainloop communication
-     *
-     * Implements a lock-free single-producer/single-consumer (SPSC) event queue
-     * to pass analysis results from the real-time audio based thread into the PipeWire mainloop.
+     * RT -> Mainloop wakeups
      *
-     * Events are produced in the RT thread (beat/onset detection, BPM, pitch, etc.) and consumed
-     * in the mainloop via a PipeWire loop event source (`event_src`).
-     *
-     * Synchronization uses atomics for head/tail indices: RT pushes to `ev_head`, the mainloop
-     * consumes from `ev_tail`. This avoids locks, which are unsafe in real-time contexts.
+     * `quantum` queues events and diagnostics on its SPSC rings; the mainloop drains them when
+     * woken through a PipeWire loop event source (`event_src`). Wakeups are coalesced: the RT
+     * side signals at most once per quantum, and only when no drain is already pending
+     * (`drain_pending`), so a busy quantum costs a single eventfd write.
+     */
+    spa_source*      event_src {nullptr};  // pw_loop_add_event
+    std::atomic_bool drain_pending {false};
+
+    DiagnosticLimiter diagnostic_limiter;  // mainloop only
+
+    // Mainloop only: the events of one drain, handed to the embedder's callback in one call
+    std::vector<Event> batch;
+
+    /*
+     * Analyzer handoff (mainloop -> RT)
      *
-     * Teardown: `stopping` signals shutdown in progress, and `quit_monitor` observes quit requests
-     * to exit the mainloop without signal-unsafe calls.
+     * When PipeWire negotiates a different rate the aubio objects are rebuilt on the mainloop
+     * and offered in `pending_analyzer`. The RT thread adopts the offer at the start of its next
+     * quantum by swapping it with the live analyzer, leaving the retired one behind for the
+     * mainloop to free, so nothing is allocated or freed on the RT thread.
      */
-    struct Event {
-        bool   is_beat;
-        bool   is_onset;
-        float  bpm;
-        float  pitch_hz;
-        double process_ms;
-    };
+    enum class Handoff : std::uint8_t { Idle, Ready, Adopting, Retired };
 
-    static constexpr std::size_t kEventCap = 1024U;
-    std::array<Event, kEventCap> events {};
-    std::atomic<std::size_t>     ev_head {0U};         // write index (Real-time)
-    std::atomic<std::size_t>     ev_tail {0U};         // read index (mainloop)
-    spa_source*                  event_src {nullptr};  // pw_loop_add_event
+    std::optional<Analyzer> pending_analyzer;
+    std::atomic<Handoff>    handoff {Handoff::Idle};
+    std::uint32_t           negotiated_rate {0U};  // mainloop only
 
-    // Stop/teardown coordination
-    std::atomic_bool stopping {false};
+    // Set by the mainloop when this stream can no longer be analyzed; the others keep running
+    std::atomic_bool failed {false};
 
-    // Monitor thread to observe 'quit' and quit mainloop safely (no signal-unsafe calls)
-    std::jthread quit_monitor;
+    StreamState(Engine& owner, std::size_t stream_index, StreamSpec stream_spec);
+    ~StreamState();
 
-    struct BPMBuffer {
-        std::array<float, kBPMCapacity> values {};
-        std::size_t                     count {0U};
-        std::size_t                     head {0U};
-    };
+    StreamState(const StreamState&)                    = delete;
+    auto operator=(const StreamState&) -> StreamState& = delete;
+    StreamState(StreamState&&)                         = delete;
+    auto operator=(StreamState&&) -> StreamState&      = delete;
 
-    BPMBuffer bpm {};
-
-    inline static std::atomic_bool quit {false};
-    inline static DetectorState*   instance {nullptr};
-
-    DetectorState(std::uint32_t buffer_size_in,
-                  bool          enable_logging,
-                  bool          enable_stats,
-                  bool          enable_pitch_detection,
-                  bool          enable_visualization)
-        : buffer_size(buffer_size_in)
-        , fft_size(buffer_size_in * 2)
-        , log_enabled(enable_logging)
-        , stats_enabled(enable_stats)
-        , pitch_enabled(enable_pitch_detection)
-        , visual_enabled(enable_visualization) {
-        instance     = this;
-        start        = std::chrono::steady_clock::now();
-        // Spawn a tiny monitor that quits the mainloop when 'quit' flips
-        quit_monitor = std::jthread([this](const std::stop_token& stop_token) -> void {
-            using namespace std::chrono_literals;
-            while (!stop_token.stop_requested()) {
-                if (DetectorState::quit.load(std::memory_order_relaxed)) {
-                    if (this->main_loop != nullptr) {
-                        pw_main_loop_quit(this->main_loop.get());
-                    }
-                    break;
-                }
-                std::this_thread::sleep_for(50ms);
+    // Shown next to this stream's output when the engine hosts more than one
+    [[nodiscard]] auto label() const -> std::string_view {
+        return spec.target.empty() ? std::string_view {"default"} : std::string_view {spec.target};
+    }
+
+    // Mainloop side: creates the PipeWire stream on the engine's core and connects it
+    [[nodiscard]] auto connect() -> std::expected<void, std::string>;
+
+    // PipeWire stream events
+    void onStateChanged(pw_stream_state state, const char* error) noexcept;
+    void onParamChanged(std::uint32_t id, const spa_pod* param) noexcept;
+    void onProcess() noexcept;  // RT
+
+    // Mainloop side, woken through `event_src`
+    void drain() noexcept;
+
+    // Mainloop side: stop analyzing this stream after an error, and leave the loop once no
+    // stream is left
+    void fail() noexcept;
+
+    // Mainloop side: print the repeats the limiter held back once their interval is over, or
+    // all of them when `everything` (at shutdown). Returns whether any are still held back.
+    auto flushDiagnostics(bool everything) -> bool;
+    void printDiagnostic(const RtDiagnostic& diagnostic, std::uint64_t suppressed) const;
+
+    // RT side, after pushing events: wake the mainloop unless it is already due to drain.
+    // Pairs with the fence in drain() so an event is never left without a wakeup.
+    void requestDrain() noexcept;
+
+    // Mainloop side: publish a new analyzer for the RT thread, replacing any offer it has not
+    // picked up yet and freeing the analyzer it retired last time
+    void offerAnalyzer(Analyzer&& next) {
+        auto state = handoff.load(std::memory_order_acquire);
+        for (;;) {
+            if (state == Handoff::Adopting) {
+                // The RT thread is mid-swap, which is a handful of pointer moves
+                std::this_thread::yield();
+                state = handoff.load(std::memory_order_acquire);
+                continue;
             }
-        });
+            if (state == Handoff::Ready
+                && !handoff.compare_exchange_weak(
+                    state, Handoff::Idle, std::memory_order_acq_rel)) {
+                continue;
+            }
+            break;
+        }
+
+        pending_analyzer.emplace(std::move(next));
+        handoff.store(Handoff::Ready, std::memory_order_release);
+    }
+
+    // Mainloop side: free the analyzer the RT thread swapped out, if any
+    void collectRetiredAnalyzer() noexcept {
+        if (handoff.load(std::memory_order_acquire) == Handoff::Retired) {
+            pending_analyzer.reset();
+            handoff.store(Handoff::Idle, std::memory_order_release);
+        }
     }
 
-    ~DetectorState() {
-        instance = nullptr;
+    // RT side, start of every quantum
+    void adoptPendingAnalyzer() noexcept {
+        auto expected = Handoff::Ready;
+        if (!handoff.compare_exchange_strong(expected,
+                                             Handoff::Adopting,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+            return;
+        }
+
+        quantum.replaceAnalyzer(pending_analyzer);
+        handoff.store(Handoff::Retired, std::memory_order_release);
     }
+
+    void printStatistics() const;
 };
 
-// PIMPL
-struct BeatDetector::Impl {
-    std::unique_ptr<DetectorState> state;
+/*
+ * One PipeWire mainloop, context and core hosting any number of capture streams.
+ *
+ * Every stream shares the engine's connection to the daemon, its data thread and the event
+ * log writer; each keeps its own analyzer, event ring and statistics, so adding an input costs
+ * a stream rather than a process.
+ */
+class Engine {
+public:
+    const EngineConfig config;
+
+    pw_raii::MainLoopPtr main_loop {nullptr};
+    pw_raii::ContextPtr  context {nullptr};
+    pw_raii::CorePtr     core {nullptr};
+
+    std::unique_ptr<EventLogWriter> log;
+
+    // Shared-memory beat clock, published from the RT thread when a name was given
+    std::string                  clock_name;
+    std::unique_ptr<ClockWriter> clock;
+
+    // Embedder's callback, mainloop only
+    BeatDetector::EventCallback on_events;
+
+    // Stable addresses: each one is PipeWire userdata. Destroyed before the core they live on.
+    std::vector<std::unique_ptr<StreamState>> streams;
+
+    std::chrono::steady_clock::time_point start;
+
+    // SIGUSR1 exports the trace buffers without stopping, ENABLE_TRACE builds only
+    spa_source* trace_signal {nullptr};
+
+    // Stop/teardown coordination. `quit` is requested from any thread and delivered to the
+    // mainloop through `quit_event`; `stopping` marks shutdown in progress on the mainloop.
+    // SIGINT/SIGTERM arrive on the mainloop directly through `signal_sources`.
+    std::atomic_bool            quit {false};
+    std::atomic_bool            stopping {false};
+    spa_source*                 quit_event {nullptr};
+    std::array<spa_source*, 2U> signal_sources {};
+
+    // Reports diagnostic repeats the streams' limiters are holding back. One-shot, and only
+    // armed while there are some, so a quiet engine never wakes for it.
+    spa_source* diagnostic_timer {nullptr};
+    bool        diagnostic_timer_armed {false};
+
+    explicit Engine(const EngineConfig& engine_config)
+        : config(engine_config)
+        , start(std::chrono::steady_clock::now()) {}
+
+    Engine(const Engine&)                    = delete;
+    auto operator=(const Engine&) -> Engine& = delete;
+    Engine(Engine&&)                         = delete;
+    auto operator=(Engine&&) -> Engine&      = delete;
+
+    ~Engine();
+
+    // Mainloop side: wire SIGINT/SIGTERM (and SIGUSR1 when tracing) and the stop() wakeup into
+    // the loop. Done before any other thread exists, so every thread inherits the signal mask
+    // the signalfd sets up.
+    [[nodiscard]] auto watchQuit() -> std::expected<void, std::string>;
+
+    // Mainloop side: create `diagnostic_timer`, disarmed
+    [[nodiscard]] auto watchDiagnostics() -> std::expected<void, std::string>;
+
+    // Mainloop side: fire `diagnostic_timer` one interval from now, unless it is already due
+    void armDiagnosticTimer() noexcept;
+
+    // Mainloop side, `diagnostic_timer` expired: report what is due and re-arm while any
+    // stream is still holding repeats back
+    void flushDiagnostics();
+
+    // Mainloop side: stop scheduling .process and leave the loop
+    void shutdown() noexcept;
+
+    // Any thread
+    void requestQuit() noexcept {
+        quit.store(true, std::memory_order_relaxed);
+        if (quit_event != nullptr) {
+            pw_loop_signal_event(loop(), quit_event);
+        }
+    }
+
+    [[nodiscard]] auto quitRequested() const noexcept -> bool {
+        return quit.load(std::memory_order_relaxed) || signal_quit.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto loop() const noexcept -> pw_loop* {
+        return pw_main_loop_get_loop(main_loop.get());
+    }
 };
 
-BeatDetector::BeatDetector(std::uint32_t buffer_size,
-                           bool          enable_logging,
-                           bool          enable_performance_stats,
-                           bool          enable_pitch_detection,
-                           bool          enable_visual_feedback)
-    : impl_(std::make_unique<Impl>()) {
-    impl_->state = std::make_unique<DetectorState>(buffer_size,
-                                                   enable_logging,
-                                                   enable_performance_stats,
-                                                   enable_pitch_detection,
-                                                   enable_visual_feedback);
+Engine::~Engine() {
+    Engine* registered = this;
+    signal_engine.compare_exchange_strong(registered, nullptr);
+
+    streams.clear();
+    if (main_loop != nullptr) {
+        for (auto* source :
+             {trace_signal, quit_event, diagnostic_timer, signal_sources[0], signal_sources[1]}) {
+            if (source != nullptr) {
+                pw_loop_destroy_source(loop(), source);
+            }
+        }
+    }
 }
 
-BeatDetector::~BeatDetector() {
-    auto& current_state = *impl_->state;
-    if (current_state.stats_enabled) {
-        const auto duration = std::chrono::duration_cast<std::chrono::seconds>(
-                                  std::chrono::steady_clock::now() - current_state.start)
-                                  .count();
-        std::println("\n{} Final Statistics:", u8fmt::wrapU8string(icons::kStats));
-        std::println("\t{} Total runtime: {} seconds",
-                     u8fmt::wrapU8string(icons::kRuntime),
-                     duration);
-        std::println("\t{} Total beat detected: {}",
-                     u8fmt::wrapU8string(icons::kNote),
-                     current_state.total_beats);
-        std::println("\t{} Total onsets detected: {}",
-                     u8fmt::wrapU8string(icons::kNote),
-                     current_state.total_onsets);
-    }
-
-    if (!current_state.processing_times_ms.empty()) {
-        const auto [min_processing_it, max_processing_it] =
-            std::ranges::minmax_element(current_state.processing_times_ms);
-        const double average_processing_time =
-            std::accumulate(current_state.processing_times_ms.begin(),
-                            current_state.processing_times_ms.end(),
-                            0.0)
-            / static_cast<double>(current_state.processing_times_ms.size());
-
-        std::println("\t{} Average processing time: {:.3F} ms",
+auto Engine::watchQuit() -> std::expected<void, std::string> {
+    quit_event = pw_loop_add_event(
+        loop(),
+        +[](void* userdata, std::uint64_t /*count*/) -> void {
+            static_cast<Engine*>(userdata)->shutdown();
+        },
+        this);
+    if (quit_event == nullptr) {
+        return std::unexpected("failed to create quit event");
+    }
+
+    constexpr std::array kQuitSignals {SIGINT, SIGTERM};
+    for (std::size_t index = 0U; index < kQuitSignals.size(); ++index) {
+        signal_sources[index] = pw_loop_add_signal(
+            loop(),
+            kQuitSignals[index],
+            +[](void* userdata, int /*signal_number*/) -> void {
+                auto* engine = static_cast<Engine*>(userdata);
+                engine->quit.store(true, std::memory_order_relaxed);
+                engine->shutdown();
+            },
+            this);
+        if (signal_sources[index] == nullptr) {
+            return std::unexpected(std::format("failed to watch signal {}", kQuitSignals[index]));
+        }
+    }
+
+    if constexpr (trace::kEnabled) {
+        trace_signal = pw_loop_add_signal(
+            loop(),
+            SIGUSR1,
+            +[](void* /*userdata*/, int /*signal_number*/) -> void { exportTrace(); },
+            nullptr);
+        if (trace_signal == nullptr) {
+            return std::unexpected(std::format("failed to watch signal {}", SIGUSR1));
+        }
+    }
+
+    signal_engine.store(this, std::memory_order_release);
+    return {};
+}
+
+auto Engine::watchDiagnostics() -> std::expected<void, std::string> {
+    diagnostic_timer = pw_loop_add_timer(
+        loop(),
+        +[](void* userdata, std::uint64_t /*expirations*/) -> void {
+            static_cast<Engine*>(userdata)->flushDiagnostics();
+        },
+        this);
+    if (diagnostic_timer == nullptr) {
+        return std::unexpected("failed to create diagnostic timer");
+    }
+    return {};
+}
+
+void Engine::armDiagnosticTimer() noexcept {
+    if (diagnostic_timer == nullptr || diagnostic_timer_armed) {
+        return;
+    }
+
+    // Every repeat held back now is due by then: its line was printed less than kInterval ago
+    constexpr auto kSeconds = std::chrono::seconds {DiagnosticLimiter::kInterval}.count();
+    timespec       value {.tv_sec = kSeconds, .tv_nsec = 0};
+    diagnostic_timer_armed =
+        pw_loop_update_timer(loop(), diagnostic_timer, &value, nullptr, false) >= 0;
+}
+
+void Engine::flushDiagnostics() {
+    diagnostic_timer_armed = false;
+
+    bool holding = false;
+    for (auto& stream : streams) {
+        holding = stream->flushDiagnostics(false) || holding;
+    }
+    if (holding) {
+        armDiagnosticTimer();
+    }
+}
+
+void Engine::shutdown() noexcept {
+    // Step 1: ask PipeWire to stop scheduling .process
+    stopping.store(true, std::memory_order_relaxed);
+    for (auto& stream : streams) {
+        if (stream->stream != nullptr) {
+            pw_stream_set_active(stream->stream.get(), false);
+        }
+    }
+
+    // Step 2: state_changed(PAUSED) disconnects each stream if the loop still sees it
+    pw_main_loop_quit(main_loop.get());
+}
+
+StreamState::StreamState(Engine& owner, std::size_t stream_index, StreamSpec stream_spec)
+    : engine(owner)
+    , index(stream_index)
+    , spec(std::move(stream_spec))
+    , quantum(QuantumConfig {
+          .buffer_size    = owner.config.buffer_size,
+          .fft_size       = owner.config.fft_size,
+          .channels       = std::clamp<std::uint32_t>(
+              owner.config.capture.channels,
+              1U,
+              static_cast<std::uint32_t>(audio_blocks::kMaxChannels)),
+          .select_channel = owner.config.capture.select_channel,
+          .stream         = stream_index,
+          .pitch_enabled  = owner.config.pitch_enabled,
+          .stats_enabled  = owner.config.stats_enabled}) {
+    quantum.setWake(
+        +[](void* context) noexcept -> void { static_cast<StreamState*>(context)->requestDrain(); },
+        this);
+    batch.reserve(QuantumProcessor::kEventCap);
+}
+
+StreamState::~StreamState() {
+    stream.reset();
+    if (event_src != nullptr && engine.main_loop != nullptr) {
+        pw_loop_destroy_source(engine.loop(), event_src);
+    }
+}
+
+void StreamState::requestDrain() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (event_src != nullptr && !drain_pending.exchange(true, std::memory_order_relaxed)) {
+        pw_loop_signal_event(engine.loop(), event_src);
+    }
+}
+
+void StreamState::printStatistics() const {
+    std::println("\t{} Total beat detected: {}",
+                 u8fmt::wrapU8string(icons::kNote),
+                 quantum.totalBeats());
+    std::println("\t{} Total onsets detected: {}",
+                 u8fmt::wrapU8string(icons::kNote),
+                 quantum.totalOnsets());
+
+    const auto status = quantum.healthSnapshot();
+    if (status.dropped_events > 0U) {
+        std::println("\t{} Events dropped (queue full): {}",
+                     u8fmt::wrapU8string(icons::kFail),
+                     status.dropped_events);
+    }
+    if (status.xruns > 0U || status.late_callbacks > 0U || status.overruns > 0U) {
+        std::println("\t{} Xruns: {}, late callbacks: {}, overruns: {} ({} quanta)",
+                     u8fmt::wrapU8string(icons::kFail),
+                     status.xruns,
+                     status.late_callbacks,
+                     status.overruns,
+                     status.quanta);
+    }
+    for (std::size_t error = 0U; error < status.rejected_buffers.size(); ++error) {
+        if (const auto rejected = status.rejected_buffers[error]; rejected > 0U) {
+            std::println("\t{} Buffers rejected ({}): {}",
+                         u8fmt::wrapU8string(icons::kFail),
+                         audio_blocks::toString(static_cast<audio_blocks::ViewError>(error)),
+                         rejected);
+        }
+    }
+
+    if (const auto& block_times = quantum.blockTimes(); block_times.count() > 0U) {
+        constexpr auto to_ms = [](std::uint64_t nanoseconds) {
+            return static_cast<double>(nanoseconds) / 1e6;
+        };
+
+        std::println("\t{} Average processing time: {:.3F} ms ({} blocks)",
                      u8fmt::wrapU8string(icons::kBolt),
-                     average_processing_time);
+                     block_times.mean() / 1e6,
+                     block_times.count());
+        std::println("\t{} Processing time p50/p90/p99/p99.9: {:.3F} / {:.3F} / {:.3F} / {:.3F} ms",
+                     u8fmt::wrapU8string(icons::kUpChart),
+                     to_ms(block_times.percentile(0.50)),
+                     to_ms(block_times.percentile(0.90)),
+                     to_ms(block_times.percentile(0.99)),
+                     to_ms(block_times.percentile(0.999)));
         std::println("\t{} Max processing time: {:.3F} ms",
                      u8fmt::wrapU8string(icons::kUpChart),
-                     *max_processing_it);
+                     to_ms(block_times.max()));
         std::println("\t{} Min processing time: {:.3F} ms",
                      u8fmt::wrapU8string(icons::kDownChart),
-                     *min_processing_it);
+                     to_ms(block_times.min()));
+    }
+
+    if (const auto& load = quantum.quantumLoad(); load.count() > 0U) {
+        constexpr auto to_percent = [](std::uint64_t scaled) {
+            return 100.0 * static_cast<double>(scaled)
+                 / static_cast<double>(QuantumProcessor::kLoadScale);
+        };
+
+        std::println("\t{} Quantum budget used p50/p90/p99/p99.9/max: "
+                     "{:.1F}% / {:.1F}% / {:.1F}% / {:.1F}% / {:.1F}%",
+                     u8fmt::wrapU8string(icons::kBolt),
+                     to_percent(load.percentile(0.50)),
+                     to_percent(load.percentile(0.90)),
+                     to_percent(load.percentile(0.99)),
+                     to_percent(load.percentile(0.999)),
+                     to_percent(load.max()));
     }
 
-    if (auto& state_bpm = current_state.bpm; state_bpm.count > 0) {
-        auto index_range = std::views::iota(std::size_t {0}, state_bpm.count);
+    if (const auto average = quantum.averageBpm(); average > 0.0F) {
+        std::println("\t{} Final average BPM: {:.1F}", u8fmt::wrapU8string(icons::kBpm), average);
+    }
+}
 
-        auto bpm_value_view = index_range | std::views::transform([&state_bpm](std::size_t index) {
-                                  const std::size_t capacity = DetectorState::kBPMCapacity;
-                                  const std::size_t first_index =
-                                      (state_bpm.head + capacity - state_bpm.count) % capacity;
-                                  return state_bpm.values[(first_index + index) % capacity];
-                              });
+namespace {
+
+// Shared by every stream, `userdata` is the StreamState
+const pw_stream_events kStreamEvents {
+    .version = PW_VERSION_STREAM_EVENTS,  // behave clang-format
+    .destroy = +[](void* userdata) noexcept -> void {
+        auto* state = static_cast<StreamState*>(userdata);
+        if (state != nullptr && state->stream != nullptr) {
+            // The stream is being destroyed by PipeWire right now
+            // Drop ownership without calling the deleter again
+            (void) state->stream.release();
+        }
+    },
+
+    // Force the lambda to decay to a function pointer with +[] (needed for C callback)
+    .state_changed = +[](void* userdata,
+                         pw_stream_state /*old*/,
+                         pw_stream_state state,
+                         const char*     error) noexcept -> void {
+        static_cast<StreamState*>(userdata)->onStateChanged(state, error);
+    },
+    .control_info  = nullptr,
+    .io_changed    = nullptr,
+    .param_changed = +[](void* userdata, std::uint32_t id, const spa_pod* param) noexcept -> void {
+        static_cast<StreamState*>(userdata)->onParamChanged(id, param);
+    },
+    .add_buffer    = nullptr,
+    .remove_buffer = nullptr,
+    .process       = +[](void* userdata) noexcept -> void {
+        static_cast<StreamState*>(userdata)->onProcess();
+    },
+    .drained       = nullptr,
+    .command       = nullptr,
+    .trigger_done  = nullptr};
 
-        const float total_bpm = std::accumulate(bpm_value_view.begin(), bpm_value_view.end(), 0.0F);
-        const float average_bpm = total_bpm / static_cast<float>(state_bpm.count);
+}  // namespace
 
-        std::println("\t{} Final average BPM: {:.1F}",
-                     u8fmt::wrapU8string(icons::kBpm),
-                     average_bpm);
+void StreamState::onStateChanged(pw_stream_state state, const char* error) noexcept {
+    if (engine.streams.size() > 1U) {
+        std::println("{} Stream {} ({}) state: {}",
+                     icons::pw::iconFor(state),
+                     index,
+                     label(),
+                     pw_stream_state_as_string(state));
+    } else {
+        std::println("{} Stream state: {}",
+                     icons::pw::iconFor(state),
+                     pw_stream_state_as_string(state));
     }
 
-    if (current_state.log.is_open()) {
-        current_state.log.close();
+    if (state == PW_STREAM_STATE_ERROR) {
+        std::println(std::cerr,
+                     "{} Stream error: {}",
+                     u8fmt::wrapU8string(icons::kFail),
+                     error ? error : "unknown");
+        fail();
+        if (stream != nullptr) {
+            pw_stream_disconnect(stream.get());  // an errored stream never reaches PAUSED
+        }
     }
 
-    impl_->state.reset();
-    pw_deinit();
-    std::println("\n{} Cleanup complete - All resources freed!",
-                 u8fmt::wrapU8string(icons::kCheck));
+    // If we requested stop, disconnect once paused to avoid RT rac
+    if (state == PW_STREAM_STATE_PAUSED
+        && (engine.stopping.load(std::memory_order_relaxed)
+            || failed.load(std::memory_order_relaxed))
+        && stream != nullptr) {
+        pw_stream_disconnect(stream.get());
+    }
 }
 
-[[nodiscard]] static auto averageBpm(const DetectorState& state) {
-    const auto& state_bpm = state.bpm;
+void StreamState::onParamChanged(std::uint32_t id, const spa_pod* param) noexcept {
+    if (param == nullptr || id != SPA_PARAM_Format) {
+        return;
+    }
+
+    std::uint32_t media_type    = 0U;
+    std::uint32_t media_subtype = 0U;
+    if (spa_format_parse(param, &media_type, &media_subtype) < 0
+        || media_type != SPA_MEDIA_TYPE_audio || media_subtype != SPA_MEDIA_SUBTYPE_raw) {
+        return;
+    }
+
+    spa_audio_info_raw info {};
+    if (spa_format_audio_raw_parse(param, &info) < 0 || info.rate == 0U) {
+        return;
+    }
+
+    const auto spec_in = audio_blocks::sampleSpecFromSpa(info.format);
+    if (!spec_in) {
+        std::println(std::cerr,
+                     "{} Unsupported sample format: {}",
+                     u8fmt::wrapU8string(icons::kFail),
+                     info.format);
+        fail();
+        return;
+    }
+    quantum.setSampleSpec(*spec_in);
+
+    std::println("{} Negotiated format{}: {} {}, {} Hz, {} channel(s)",
+                 u8fmt::wrapU8string(icons::kCircle),
+                 engine.streams.size() > 1U ? std::format(" for {}", label()) : std::string {},
+                 audio_blocks::toString(spec_in->format),
+                 spec_in->byte_order == std::endian::little ? "LE" : "BE",
+                 info.rate,
+                 info.channels);
+    if (!spec_in->isNativeF32()) {
+        std::println("\tConverted in-process (kernel: {})", audio_blocks::convertKernelName());
+    }
 
-    if (state.bpm.count == 0) {
-        return 0.0F;
+    if (info.rate == negotiated_rate) {
+        return;
     }
 
-    const auto bpm_value_view = std::views::iota(std::size_t {0}, state_bpm.count)
-                                | std::views::transform([&](std::size_t index) {
-                                      const std::size_t capacity = DetectorState::kBPMCapacity;
-                                      const std::size_t first_index =
-                                          (state_bpm.head + capacity - state_bpm.count) % capacity;
-                                      return state_bpm.values[(first_index + index) % capacity];
-                                  });
+    // Rebuilt here, adopted by the RT thread at the start of its next quantum
+    auto next = quantum.makeAnalyzer(info.rate);
+    if (!next) {
+        std::println(std::cerr,
+                     "{} Cannot analyze at {} Hz: {}",
+                     u8fmt::wrapU8string(icons::kFail),
+                     info.rate,
+                     next.error());
+        fail();
+        return;
+    }
 
-    const float total_bpm   = std::accumulate(bpm_value_view.begin(), bpm_value_view.end(), 0.0F);
-    const float average_bpm = total_bpm / static_cast<float>(state_bpm.count);
-    return average_bpm;
+    offerAnalyzer(std::move(*next));
+    negotiated_rate = info.rate;
 }
 
-auto BeatDetector::initialize() -> std::expected<void, std::string> {
-    auto& current_state = *impl_->state;
-    pw_init(nullptr, nullptr);
+namespace {
 
-    if (current_state.log_enabled) {
-        const auto current_time     = std::chrono::system_clock::now();
-        const auto utc_current_time = std::chrono::clock_cast<std::chrono::utc_clock>(current_time);
+constexpr std::int64_t kNanosPerSecond = 1'000'000'000;
 
-        const std::filesystem::path log_file =
-            std::format("beat_log_{:%Y%m%d_%H%M%S}Z.txt", utc_current_time);
-        current_state.log.open(log_file, std::ios::out | std::ios::trunc);
+// The stream's view of the current graph cycle, once it has timing information
+[[nodiscard]] auto graphTime(pw_stream* stream) noexcept -> std::optional<GraphTime> {
+    pw_time time {};
+    if (pw_stream_get_time_n(stream, &time, sizeof(time)) != 0 || time.now == 0
+        || time.rate.denom == 0U) {
+        return std::nullopt;
+    }
 
-        if (!current_state.log.is_open()) {
-            return std::unexpected("failed to open log file");
-        }
+    return GraphTime {.now_ns   = time.now,
+                      .delay_ns = time.delay * kNanosPerSecond
+                                  * static_cast<std::int64_t>(time.rate.num)
+                                  / static_cast<std::int64_t>(time.rate.denom)};
+}
+
+}  // namespace
 
-        std::println("{} Logging to: {}", u8fmt::wrapU8string(icons::kCircle), log_file.string());
-        std::println(current_state.log, "# Beat Detection Log - {:%F %T}", utc_current_time);
-        std::println(current_state.log, "# Timestamp,BPM,Onset,Pitch(Hz),ProcessTime(ms)");
+void StreamState::onProcess() noexcept {
+    if (engine.quitRequested() || failed.load(std::memory_order_relaxed)) {
+        return;
     }
 
-    current_state.main_loop.reset(pw_main_loop_new(nullptr));
-    if (current_state.main_loop == nullptr) {
-        return std::unexpected("failed to create main loop");
+    const trace::Scope quantum_probe {"quantum"};
+
+    adoptPendingAnalyzer();
+    const auto graph_time = graphTime(stream.get());
+
+    auto* pw_buf = pw_stream_dequeue_buffer(stream.get());
+    if (pw_buf == nullptr) {
+        return;
     }
 
-    // NOTE: we let pw_stream_new_simple create its own context/core under the hood
+    quantum.process(pw_buf->buffer, graph_time);
+    pw_stream_queue_buffer(stream.get(), pw_buf);
+}
 
-    current_state.tempo.reset(
-        new_aubio_tempo("default", current_state.fft_size, current_state.buffer_size, kSampleRate));
-    if (current_state.tempo == nullptr) {
-        return std::unexpected("failed to create aubio tempo");
+void StreamState::fail() noexcept {
+    if (failed.exchange(true, std::memory_order_relaxed)) {
+        return;
     }
 
-    current_state.input_vector.reset(new_fvec(current_state.buffer_size));
-    current_state.output_vector.reset(new_fvec(1U));
-    if (current_state.input_vector == nullptr || current_state.output_vector == nullptr) {
-        return std::unexpected("failed to create aubio buffers");
+    // Like a shutdown, but for this stream only: state_changed(PAUSED) disconnects it
+    if (stream != nullptr) {
+        pw_stream_set_active(stream.get(), false);
     }
 
-    // TODO: not entirely sure these parameters are correct, double check
-    current_state.onset.reset(
-        new_aubio_onset("default", current_state.fft_size, current_state.buffer_size, kSampleRate));
-    if (current_state.onset == nullptr) {
-        return std::unexpected("failed to create aubio onset");
+    const bool running = std::ranges::any_of(engine.streams, [](const auto& other) {
+        return !other->failed.load(std::memory_order_relaxed);
+    });
+    if (running) {
+        std::println(std::cerr,
+                     "{} Stream {} ({}) stopped, the other streams keep running",
+                     u8fmt::wrapU8string(icons::kFail),
+                     index,
+                     label());
+    } else if (engine.main_loop != nullptr) {
+        pw_main_loop_quit(engine.main_loop.get());
     }
+}
+
+void StreamState::printDiagnostic(const RtDiagnostic& diagnostic,
+                                  std::uint64_t       suppressed) const {
+    std::println(std::cerr,
+                 "\n{} {}{}{}",
+                 u8fmt::wrapU8string(icons::kFail),
+                 engine.streams.size() > 1U ? std::format("[{}] ", label()) : std::string {},
+                 describe(diagnostic),
+                 suppressed > 0U ? std::format(" ({} more since last report)", suppressed)
+                                 : std::string {});
+}
+
+auto StreamState::flushDiagnostics(bool everything) -> bool {
+    return diagnostic_limiter.flush(
+        std::chrono::steady_clock::now(),
+        everything,
+        [&](const RtDiagnostic& diagnostic, std::uint64_t suppressed) {
+            printDiagnostic(diagnostic, suppressed);
+        });
+}
+
+void StreamState::drain() noexcept {
+    const trace::Scope probe {"drain"};
 
-    if (current_state.pitch_enabled) {
-        current_state.pitch.reset(new_aubio_pitch("default",
-                                                  current_state.fft_size,
-                                                  current_state.buffer_size,
-                                                  kSampleRate));
-        current_state.pitch_buffer.reset(new_fvec(1U));
+    // Re-arm the wakeup before draining so anything pushed from now on signals again
+    drain_pending.store(false, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
 
-        if (current_state.pitch == nullptr || current_state.pitch_buffer == nullptr) {
-            return std::unexpected("failed to create aubio pitch");
+    collectRetiredAnalyzer();
+
+    const bool labelled = engine.streams.size() > 1U;
+    auto*      log      = engine.log.get();
+    const bool batching = static_cast<bool>(engine.on_events);
+
+    const auto now = std::chrono::steady_clock::now();
+    while (const auto diagnostic = quantum.diagnostics().tryPop()) {
+        const auto suppressed = diagnostic_limiter.admit(*diagnostic, now);
+        if (!suppressed) {
+            engine.armDiagnosticTimer();  // so the count is reported even if the flood stops
+            continue;
         }
-        aubio_pitch_set_unit(current_state.pitch.get(), "Hz");
-    }
-
-    static const pw_stream_events
-        events {.version = PW_VERSION_STREAM_EVENTS,  // behave clang-format
-                .destroy = +[](void* userdata) noexcept -> void {
-                    auto* state = static_cast<DetectorState*>(userdata);
-                    if (state != nullptr && state->stream != nullptr) {
-                        // The stream is being destroyed by PipeWire right now
-                        // Drop ownership without calling the deleter again
-                        (void) state->stream.release();
-                    }
-                },
-
-                // Force the lambda to decay to a function pointer with +[] (needed for C callback)
-                .state_changed = +[](void* userdata,
-                                     pw_stream_state /*old*/,
-                                     pw_stream_state state,
-                                     const char*     error) noexcept -> void {
-                    auto* event_state = static_cast<DetectorState*>(userdata);
-
-                    std::println("{} Stream state: {}",
-                                 icons::pw::iconFor(state),
-                                 pw_stream_state_as_string(state));
-
-                    if (state == PW_STREAM_STATE_ERROR) {
-                        std::println(std::cerr,
-                                     "{} Stream error: {}",
-                                     u8fmt::wrapU8string(icons::kFail),
-                                     error ? error : "unknown");
-                        if (event_state != nullptr && event_state->main_loop != nullptr) {
-                            pw_main_loop_quit(event_state->main_loop.get());
-                        }
-                    }
-
-                    // If we requested stop, disconnect once paused to avoid RT rac
-                    if (state == PW_STREAM_STATE_PAUSED) {
-                        if (event_state != nullptr
-                            && event_state->stopping.load(std::memory_order_relaxed)) {
-                            if (event_state->stream != nullptr) {
-                                pw_stream_disconnect(event_state->stream.get());
-                            }
-                        }
-                    }
-                },
-                .control_info  = nullptr,
-                .io_changed    = nullptr,
-                .param_changed = nullptr,
-                .add_buffer    = nullptr,
-                .remove_buffer = nullptr,
-
-                .process = +[](void* userdata) noexcept -> void {
-                    using Clock = std::chrono::steady_clock;
-
-                    auto* process_state = static_cast<DetectorState*>(userdata);
-                    if (process_state == nullptr
-                        || beat::DetectorState::quit.load(std::memory_order_relaxed)) {
-                        return;
-                    }
-
-                    if (auto* pw_buf = pw_stream_dequeue_buffer(process_state->stream.get());
-                        pw_buf) {
-                        // Make sure we always re-queue the buffer , even on early returns
-                        struct BufferLease {
-                            pw_stream* stream {};
-                            pw_buffer* buffer {};
-
-                            ~BufferLease() {
-                                if (stream != nullptr && buffer != nullptr) {
-                                    pw_stream_queue_buffer(stream, buffer);
-                                }
-                            }
-                        } lease {.stream = process_state->stream.get(), .buffer = pw_buf};
-
-                        if (auto* spa_buf = pw_buf->buffer; spa_buf != nullptr
-                                                            && spa_buf->datas[0].data != nullptr
-                                                            && spa_buf->datas[0].chunk != nullptr) {
-
-                            auto process_view = [&](const audio_blocks::BufferView<float>& view)
-                                -> std::expected<void, audio_blocks::ViewError> {
-                                for (auto block : view.blocks()) {
-                                    auto* destination =
-                                        fvec_get_data(process_state->input_vector.get());
-
-                                    std::ranges::copy(block, destination);
-
-                                    aubio_tempo_do(process_state->tempo.get(),
-                                                   process_state->input_vector.get(),
-                                                   process_state->output_vector.get());
-                                    const bool is_beat =
-                                        process_state->output_vector->data[0] != 0.0F;
-
-                                    aubio_onset_do(process_state->onset.get(),
-                                                   process_state->input_vector.get(),
-                                                   process_state->output_vector.get());
-                                    const bool is_onset =
-                                        process_state->output_vector->data[0] != 0.0F;
-
-                                    float pitch_hz = 0.0F;
-                                    if (process_state->pitch_enabled) {
-                                        aubio_pitch_do(process_state->pitch.get(),
-                                                       process_state->input_vector.get(),
-                                                       process_state->pitch_buffer.get());
-                                        pitch_hz = process_state->pitch_buffer->data[0];
-                                    }
-
-                                    // Real-time only bookkeeping
-                                    bool  produced_event = false;
-                                    float bpm_now        = process_state->last_bpm;
-
-                                    if (is_beat) {
-                                        ++process_state->total_beats;
-
-                                        bpm_now = aubio_tempo_get_bpm(process_state->tempo.get());
-                                        process_state->last_bpm  = bpm_now;
-                                        process_state->last_beat = Clock::now();
-
-                                        auto& bpm_buffer                   = process_state->bpm;
-                                        bpm_buffer.values[bpm_buffer.head] = bpm_now;
-                                        bpm_buffer.head =
-                                            (bpm_buffer.head + 1) % DetectorState::kBPMCapacity;
-                                        bpm_buffer.count = std::min(bpm_buffer.count + 1,
-                                                                    DetectorState::kBPMCapacity);
-
-                                        produced_event = true;
-                                    }
-
-                                    if (is_onset) {
-                                        ++process_state->total_onsets;
-                                        produced_event = true;
-                                    }
-
-                                    if (produced_event) {
-                                        // Push to the SPSC ring buffer, overwriting the oldest if
-                                        // full
-                                        const auto head =
-                                            process_state->ev_head.load(std::memory_order_relaxed);
-                                        const auto tail =
-                                            process_state->ev_tail.load(std::memory_order_acquire);
-
-                                        auto next_head = (head + 1) % DetectorState::kEventCap;
-                                        // Drop the oldest if full
-                                        if (next_head == tail) {
-                                            process_state->ev_tail
-                                                .store((tail + 1) % DetectorState::kEventCap,
-                                                       std::memory_order_release);
-                                        }
-
-                                        process_state->events[head] = DetectorState::Event {
-                                            .is_beat    = is_beat,
-                                            .is_onset   = is_onset,
-                                            .bpm        = bpm_now,
-                                            .pitch_hz   = pitch_hz,
-                                            .process_ms = 0.0  // this is filled later
-                                        };
-                                        process_state->ev_head.store(next_head,
-                                                                     std::memory_order_release);
-                                        if (process_state->event_src != nullptr) {
-                                            auto* main_loop = pw_main_loop_get_loop(
-                                                process_state->main_loop.get());
-                                            pw_loop_signal_event(main_loop,
-                                                                 process_state->event_src);
-                                        }
-                                    }
-                                }
-                                return {};  // success
-                            };
-
-                            // Build a single bounded view over the whole SPA buffer
-                            [[maybe_unused]] auto view_res =
-                                audio_blocks::makeBufferViewFromSpaMonoF32(spa_buf,
-                                                                           process_state
-                                                                               ->buffer_size)
-                                    .and_then(process_view)
-                                    .or_else([&](audio_blocks::ViewError error)
-                                                 -> std::expected<void, audio_blocks::ViewError> {
-                                        std::println(stderr,
-                                                     "SPA buffer rejected: {}",
-                                                     audio_blocks::toString(error));
-                                        return std::unexpected {error};
-                                    });
-                        }
-                    }
-                },
-
-                .drained      = nullptr,
-                .command      = nullptr,
-                .trigger_done = nullptr};
-
-    auto  properties     = pw_raii::makeAudioCaptureProperties();
-    auto* raw_properties = properties.release();  // ownership passed to PipeWire on success
-
-    auto* raw_stream = pw_stream_new_simple(pw_main_loop_get_loop(current_state.main_loop.get()),
-                                            "beat-detector",
-                                            raw_properties,  // ownership passed to PipeWire
-                                            &events,
-                                            &current_state);
-
-    if (raw_stream == nullptr) {
-        // Creation failed: free properties (we released ownership earlier)
-        if (raw_properties != nullptr) {
-            pw_properties_free(raw_properties);
+
+        printDiagnostic(*diagnostic, *suppressed);
+    }
+
+    // Drain the SPSC
+    while (const auto next_event = quantum.events().tryPop()) {
+        const auto& event = *next_event;
+
+        // Stats accumulation (mainloop side)
+        if (event.is_beat) {
+            if (engine.config.visual_enabled) {
+                const auto intensity = std::clamp(static_cast<int>(event.bpm / 20.0F), 0, 10);
+                std::print("\r{}", u8fmt::wrapU8string(icons::kMusic));
+                if (labelled) {
+                    std::print(" [{}] ", label());
+                }
+
+                for (int i = 0; i < intensity; ++i) {
+                    std::print("{}", u8fmt::wrapU8string(icons::kBlock));
+                }
+
+                for (int i = 0; i < 10; ++i) {
+                    std::print("{}", u8fmt::wrapU8string(icons::kLight));
+                }
+
+                std::print(" BPM: {:.1f} | Avg {:.1f}", event.bpm, quantum.averageBpm());
+                std::fflush(stdout);
+            } else if (labelled) {
+                std::println(" [{}] BPM: {:.1f}", label(), event.bpm);
+            } else {
+                std::println(" BPM: {:.1f}", event.bpm);
+            }
+        }
+
+        if (log != nullptr && (event.is_beat || event.is_onset)) {
+            log->append(event);
+        }
+
+        if (batching) {
+            batch.push_back(event);  // never reallocates, the ring holds at most kEventCap
         }
-        return std::unexpected("failed to  create stream");
     }
 
-    // On success we keep the stream and let PipeWire own the properties
-    current_state.stream.reset(raw_stream);
+    if (!batch.empty()) {
+        engine.on_events(std::span<const Event> {batch});
+        batch.clear();
+    }
+
+    // One writer wakeup per drain, however many records it carried
+    if (log != nullptr) {
+        const trace::Scope commit_probe {"log"};
+        log->commit();
+    }
+}
 
-    std::array<std::uint8_t, 1024> buffer {};
-    spa_pod_builder                builder = SPA_POD_BUILDER_INIT(buffer.data(), buffer.size());
+auto StreamState::connect() -> std::expected<void, std::string> {
+    auto properties = pw_raii::makeAudioCaptureProperties();
+    if (properties == nullptr) {
+        return std::unexpected("failed to allocate stream properties");
+    }
+    if (!spec.target.empty()) {
+        // A node name or object.serial; the session manager links us to it
+        pw_properties_set(properties.get(), PW_KEY_TARGET_OBJECT, spec.target.c_str());
+    }
 
-    spa_audio_info_raw audio_info {};
-    audio_info.format   = SPA_AUDIO_FORMAT_F32_LE;  // REVIEW: might want to make this portable
-    audio_info.channels = kChannels;
-    audio_info.rate     = kSampleRate;
-    audio_info.flags    = 0;
+    // Ownership of the properties is taken by PipeWire, even on failure
+    stream.reset(pw_stream_new(engine.core.get(), "beat-detector", properties.release()));
+    if (stream == nullptr) {
+        return std::unexpected(std::format("failed to create stream for {}", label()));
+    }
+    pw_stream_add_listener(stream.get(), &listener, &kStreamEvents, this);
+
+    // An EnumFormat is five fixed properties (~160 bytes) plus a channel position array of 4
+    // bytes per channel; sized for every format at the most channels we accept
+    constexpr std::size_t kFormatPodSize = 256U + (4U * audio_blocks::kMaxChannels);
+    constexpr std::size_t kBufferSize    = audio_blocks::kSpaSampleFormats.size() * kFormatPodSize;
+
+    std::array<std::uint8_t, kBufferSize> buffer {};
+    spa_pod_builder                       builder =
+        SPA_POD_BUILDER_INIT(buffer.data(), buffer.size());
+
+    // One EnumFormat per layout we can convert ourselves, so an integer device does not need a
+    // converter in front of us
+    std::array<const spa_pod*, audio_blocks::kSpaSampleFormats.size()> params {};
+    std::ranges::transform(
+        audio_blocks::kSpaSampleFormats,
+        params.begin(),
+        [&](const audio_blocks::SpaSampleFormat& format) -> const spa_pod* {
+            spa_audio_info_raw audio_info {};
+            audio_info.format   = format.spa;
+            audio_info.channels = quantum.config().channels;
+            audio_info.rate     = engine.config.capture.sample_rate;  // 0 leaves the rate out
+            audio_info.flags    = 0;
+            return spa_format_audio_raw_build(&builder, SPA_PARAM_EnumFormat, &audio_info);
+        });
+    if (std::ranges::contains(params, nullptr)) {
+        return std::unexpected(std::format("failed to build the formats for {}", label()));
+    }
 
-    auto params = std::to_array<const spa_pod*>(
-        {spa_format_audio_raw_build(&builder, SPA_PARAM_EnumFormat, &audio_info)});
+    // Create a mainloop event to drain the real-time events and perform IO safely. Before
+    // connecting, so it is in place by the time the RT thread first signals it.
+    event_src = pw_loop_add_event(
+        engine.loop(),
+        +[](void* userdata, std::uint64_t /*count*/) -> void {
+            static_cast<StreamState*>(userdata)->drain();
+        },
+        this);
+    if (event_src == nullptr) {
+        return std::unexpected(std::format("failed to create drain event for {}", label()));
+    }
 
-    if (pw_stream_connect(current_state.stream.get(),
+    if (pw_stream_connect(stream.get(),
                           PW_DIRECTION_INPUT,
                           PW_ID_ANY,
                           static_cast<pw_stream_flags>(PW_STREAM_FLAG_AUTOCONNECT
@@ -562,117 +982,295 @@ auto BeatDetector::initialize() -> std::expected<void, std::string> {
                           params.size())
         < 0) {
         // If the connect fails we destroy the stream to avoid leaking it
-        current_state.stream.reset();
-        return std::unexpected("failed to connect to stream");
+        stream.reset();
+        return std::unexpected(std::format("failed to connect stream for {}", label()));
     }
 
-    // Create a mainloop event to drain the real-time events and perform IO safely
-    current_state.event_src = pw_loop_add_event(
-        pw_main_loop_get_loop(current_state.main_loop.get()),
-        +[](void* userdata, std::uint64_t /*count*/) -> void {
-            auto* state = static_cast<DetectorState*>(userdata);
-            if (state == nullptr) {
-                return;
+    return {};
+}
+
+// PIMPL
+struct BeatDetector::Impl {
+    std::unique_ptr<Engine> engine;
+};
+
+BeatDetector::BeatDetector(std::uint32_t         buffer_size,
+                           bool                  enable_logging,
+                           bool                  enable_performance_stats,
+                           bool                  enable_pitch_detection,
+                           bool                  enable_visual_feedback,
+                           const CaptureOptions& capture)
+    : impl_(std::make_unique<Impl>()) {
+    impl_->engine =
+        std::make_unique<Engine>(EngineConfig {.buffer_size    = buffer_size,
+                                               .fft_size       = buffer_size * 2,
+                                               .capture        = capture,
+                                               .log_enabled    = enable_logging,
+                                               .stats_enabled  = enable_performance_stats,
+                                               .pitch_enabled  = enable_pitch_detection,
+                                               .visual_enabled = enable_visual_feedback});
+}
+
+BeatDetector::~BeatDetector() {
+    auto& engine = *impl_->engine;
+    for (const auto& stream : engine.streams) {
+        stream->flushDiagnostics(true);
+    }
+
+    if (engine.config.stats_enabled) {
+        const auto duration = std::chrono::duration_cast<std::chrono::seconds>(
+                                  std::chrono::steady_clock::now() - engine.start)
+                                  .count();
+        std::println("\n{} Final Statistics:", u8fmt::wrapU8string(icons::kStats));
+        std::println("\t{} Total runtime: {} seconds",
+                     u8fmt::wrapU8string(icons::kRuntime),
+                     duration);
+
+        for (const auto& stream : engine.streams) {
+            if (engine.streams.size() > 1U) {
+                std::println("\n\t{} Stream {} ({}):",
+                             u8fmt::wrapU8string(icons::kCircle),
+                             stream->index,
+                             stream->label());
             }
+            stream->printStatistics();
+        }
+    }
 
-            // Drain the SPSC
-            for (;;) {
-                const auto tail = state->ev_tail.load(std::memory_order_acquire);
-                const auto head = state->ev_head.load(std::memory_order_acquire);
-                // Break if empty
-                if (tail == head) {
-                    break;
-                }
+    if (engine.log) {
+        if (const auto dropped = engine.log->dropped(); dropped > 0U) {
+            std::println("\t{} Log records dropped: {}",
+                         u8fmt::wrapU8string(icons::kCircle),
+                         dropped);
+        }
+        engine.log.reset();  // joins the writer after it flushes
+    }
 
-                const auto event = state->events[tail];
-                state->ev_tail.store((tail + 1) % DetectorState::kEventCap,
-                                     std::memory_order_release);
-
-                // Stats accumulation (mainloop side)
-                // Per-event timing does not exist (yet?)
-                if (event.is_beat) {
-                    if (state->visual_enabled) {
-                        const auto intensity =
-                            std::clamp(static_cast<int>(event.bpm / 20.0F), 0, 10);
-                        std::print("\r{}", u8fmt::wrapU8string(icons::kMusic));
-
-                        for (int i = 0; i < intensity; ++i) {
-                            std::print("{}", u8fmt::wrapU8string(icons::kBlock));
-                        }
-
-                        for (int i = 0; i < 10; ++i) {
-                            std::print("{}", u8fmt::wrapU8string(icons::kLight));
-                        }
-
-                        std::print(" BPM: {:.1f} | Avg {:.1f}", event.bpm, averageBpm(*state));
-                        std::fflush(stdout);
-                    } else {
-                        std::println(" BPM: {:.1f}", event.bpm);
-                    }
-                }
+    if constexpr (trace::kEnabled) {
+        exportTrace();
+    }
 
-                if (state->log_enabled && state->log.is_open()
-                    && (event.is_beat || event.is_onset)) {
-                    const auto current_time = std::chrono::system_clock::now();
-                    const auto current_time_ms =
-                        std::chrono::duration_cast<std::chrono::milliseconds>(
-                            current_time.time_since_epoch())
-                        % 1000;
-                    std::println(state->log,
-                                 "{:%T}.{:03},{:.1f},{},{:.3f},",
-                                 current_time,
-                                 static_cast<int>(current_time_ms.count()),
-                                 (event.is_beat ? event.bpm : 0.0F),
-                                 event.is_onset ? 1 : 0,
-                                 event.pitch_hz);
-                }
+    impl_->engine.reset();
+    pw_deinit();
+    std::println("\n{} Cleanup complete - All resources freed!",
+                 u8fmt::wrapU8string(icons::kCheck));
+}
+
+auto BeatDetector::addStream(StreamSpec spec) -> std::expected<std::size_t, std::string> {
+    auto& engine = *impl_->engine;
+    if (engine.main_loop != nullptr) {
+        return std::unexpected("streams must be added before initialize()");
+    }
+    if (engine.streams.size() >= kMaxStreams) {
+        return std::unexpected(std::format("at most {} streams are supported", kMaxStreams));
+    }
+
+    const auto index = engine.streams.size();
+    engine.streams.push_back(std::make_unique<StreamState>(engine, index, std::move(spec)));
+    return index;
+}
+
+auto BeatDetector::publishClock(std::string name) -> std::expected<void, std::string> {
+    auto& engine = *impl_->engine;
+    if (engine.main_loop != nullptr) {
+        return std::unexpected("the beat clock must be requested before initialize()");
+    }
+    if (name.empty()) {
+        return std::unexpected("the beat clock needs a shared memory name");
+    }
+
+    engine.clock_name = std::move(name);
+    return {};
+}
+
+auto BeatDetector::initialize() -> std::expected<void, std::string> {
+    auto& engine = *impl_->engine;
+    pw_init(nullptr, nullptr);
+
+    // Without explicit streams, capture from the default source like a single-input detector
+    if (engine.streams.empty()) {
+        if (auto added = addStream(StreamSpec {}); !added) {
+            return std::unexpected(added.error());
+        }
+    }
+
+    // First, so the log writer and PipeWire's threads start with the watched signals blocked
+    engine.main_loop.reset(pw_main_loop_new(nullptr));
+    if (engine.main_loop == nullptr) {
+        return std::unexpected("failed to create main loop");
+    }
+    if (auto watching = engine.watchQuit(); !watching) {
+        return std::unexpected(watching.error());
+    }
+    if (auto watching = engine.watchDiagnostics(); !watching) {
+        return std::unexpected(watching.error());
+    }
+
+    if (engine.config.log_enabled) {
+        const auto current_time     = std::chrono::system_clock::now();
+        const auto utc_current_time = std::chrono::clock_cast<std::chrono::utc_clock>(current_time);
+
+        const std::filesystem::path log_file =
+            std::format("beat_log_{:%Y%m%d_%H%M%S}Z.bin", utc_current_time);
+
+        auto writer = EventLogWriter::open(log_file);
+        if (!writer) {
+            return std::unexpected(std::format("failed to open log file: {}", writer.error()));
+        }
+        engine.log = std::move(*writer);
+
+        std::println("{} Logging to: {} (convert with --convert-log)",
+                     u8fmt::wrapU8string(icons::kCircle),
+                     log_file.string());
+    }
+
+    if (!engine.clock_name.empty()) {
+        auto clock = ClockWriter::create(engine.clock_name, engine.streams.size());
+        if (!clock) {
+            return std::unexpected(std::format("failed to create beat clock: {}", clock.error()));
+        }
+        engine.clock = std::move(*clock);
+        for (auto& stream : engine.streams) {
+            stream->quantum.setClock(engine.clock.get());
+        }
+
+        std::println("{} Beat clock: /dev/shm{}",
+                     u8fmt::wrapU8string(icons::kCircle),
+                     engine.clock->name());
+    }
+
+    if constexpr (trace::kEnabled) {
+        trace::start();
+    }
+
+    // Resolve the conversion kernels now rather than on the first RT quantum
+    (void) audio_blocks::downmixKernelName();
+    (void) audio_blocks::convertKernelName();
+
+    // One context and one daemon connection for every stream
+    engine.context.reset(pw_context_new(engine.loop(), nullptr, 0));
+    if (engine.context == nullptr) {
+        return std::unexpected("failed to create context");
+    }
+
+    engine.core.reset(pw_context_connect(engine.context.get(), nullptr, 0));
+    if (engine.core == nullptr) {
+        return std::unexpected("failed to connect to PipeWire");
+    }
+
+    const auto requested_rate = engine.config.capture.sample_rate;
+    for (auto& stream : engine.streams) {
+        // With a fixed rate the analyzer is ready before the first quantum; when following the
+        // graph it is created once param_changed reports the negotiated rate
+        if (requested_rate != CaptureOptions::kGraphRate) {
+            if (auto started = stream->quantum.start(requested_rate); !started) {
+                return std::unexpected(started.error());
             }
-        },
-        &current_state);
+            stream->negotiated_rate = requested_rate;
+        }
+
+        if (auto connected = stream->connect(); !connected) {
+            return std::unexpected(connected.error());
+        }
+    }
 
     return {};
 }
 
+void BeatDetector::setEventCallback(EventCallback callback) {
+    impl_->engine->on_events = std::move(callback);
+}
+
+auto BeatDetector::snapshot(std::size_t stream) const noexcept -> BeatSnapshot {
+    const auto& streams = impl_->engine->streams;
+    if (stream >= streams.size()) {
+        return {};
+    }
+
+    const auto state = streams[stream]->quantum.tempo();
+
+    BeatSnapshot snapshot {.bpm          = state.bpm,
+                           .confidence   = state.confidence,
+                           .beats        = state.beats,
+                           .last_beat_ns = state.last_beat_ns};
+
+    // Phase is extrapolated to the moment of the call from the last beat and the current tempo
+    if (state.beats > 0U && state.bpm > 0.0F) {
+        const auto now_ns = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch())
+                .count());
+        const auto elapsed_ns = static_cast<double>(now_ns - std::min(now_ns, state.last_beat_ns));
+        const auto period_ns  = 60e9 / static_cast<double>(state.bpm);
+        snapshot.phase        = static_cast<float>(std::fmod(elapsed_ns / period_ns, 1.0));
+    }
+
+    return snapshot;
+}
+
+auto BeatDetector::health(std::size_t stream) const noexcept -> StreamHealth {
+    const auto& streams = impl_->engine->streams;
+    return stream < streams.size() ? streams[stream]->quantum.healthSnapshot() : StreamHealth {};
+}
+
+auto BeatDetector::streamCount() const noexcept -> std::size_t {
+    return impl_->engine->streams.size();
+}
+
 void BeatDetector::run() {
-    auto& current_state = *impl_->state;
-    if (current_state.main_loop == nullptr) {
+    auto& engine = *impl_->engine;
+    if (engine.main_loop == nullptr) {
         return;
     }
 
-    DetectorState::quit.store(false, std::memory_order_relaxed);
-
     std::println("\n{} Beat Detector Started!", u8fmt::wrapU8string(icons::kBpm));
-    std::println("\t Buffer size: {} samples", current_state.buffer_size);
-    std::println("\tSample rate: {} Hz", kSampleRate);
+    std::println("\t Buffer size: {} samples", engine.config.buffer_size);
+    if (engine.config.capture.sample_rate == CaptureOptions::kGraphRate) {
+        std::println("\tSample rate: graph rate");
+    } else {
+        std::println("\tSample rate: {} Hz", engine.config.capture.sample_rate);
+    }
+    if (engine.config.capture.channels > 1U) {
+        std::println("\tChannels: {} (downmix kernel: {})",
+                     engine.config.capture.channels,
+                     audio_blocks::downmixKernelName());
+    }
+    if (engine.streams.size() > 1U) {
+        std::println("\tStreams:");
+        for (const auto& stream : engine.streams) {
+            std::println("\t  {}: {}", stream->index, stream->label());
+        }
+    } else if (!engine.streams.front()->spec.target.empty()) {
+        std::println("\tTarget: {}", engine.streams.front()->spec.target);
+    }
     std::println("\tFeatures enabled:");
 
-    featureLine("Logging", current_state.log_enabled, icons::kCircle);
-    featureLine("Performance", current_state.stats_enabled, icons::kStats);
-    featureLine("Pitch", current_state.pitch_enabled, icons::kPitch);
-    featureLine("Visual", current_state.visual_enabled, icons::kCircle);
+    featureLine("Logging", engine.config.log_enabled, icons::kCircle);
+    featureLine("Performance", engine.config.stats_enabled, icons::kStats);
+    featureLine("Pitch", engine.config.pitch_enabled, icons::kPitch);
+    featureLine("Visual", engine.config.visual_enabled, icons::kCircle);
 
     std::println("\n{} Listening for beats... Press Ctrl+C to stop.\n",
                  u8fmt::wrapU8string(icons::kNote));
 
-    pw_main_loop_run(current_state.main_loop.get());
+    // E.g. Ctrl+C while initialize() was still connecting
+    if (engine.quitRequested()) {
+        return;
+    }
+    pw_main_loop_run(engine.main_loop.get());
 }
 
 void BeatDetector::stop() noexcept {
-    auto& current_state = *impl_->state;
-    DetectorState::quit.store(true, std::memory_order_relaxed);
-
-    if (current_state.stream != nullptr) {
-        // Step 1: ask PipeWire to stop scheduling .process
-        current_state.stopping.store(true, std::memory_order_relaxed);
-        pw_stream_set_active(current_state.stream.get(), false);
-        // Step 2: in state_changed(PAUSED) we will pw_stream_disconnect()
-    }
+    // Any thread: the mainloop deactivates the streams and leaves run()
+    impl_->engine->requestQuit();
 }
 
 void BeatDetector::signalHandler(int) noexcept {
-    if (DetectorState::instance != nullptr) {
-        // Async-signal safe: only set the flag
-        beat::DetectorState::quit.store(true, std::memory_order_relaxed);
+    // Async-signal safe: an atomic store and an eventfd write. Only needed when the signal
+    // reaches a thread that does not have it blocked, e.g. one the host created early.
+    signal_quit.store(true, std::memory_order_relaxed);
+    if (auto* engine = signal_engine.load(std::memory_order_acquire); engine != nullptr) {
+        engine->requestQuit();
     }
 }
 
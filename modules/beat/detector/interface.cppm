@@ -1,34 +1,100 @@
 module;
+#include <cstddef>
 #include <cstdint>
 #include <expected>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
 
 export module beat.detector;
 
 export import :aubio_raii;
+export import :analysis;
+export import :batch;
+export import :clock;
+export import :event_log;
+export import :offline;
 export import :pw_raii;
+export import :quantum;
 
 export namespace beat {
 
+// How the live stream is captured
+struct CaptureOptions {
+    static constexpr std::uint32_t kGraphRate = 0U;  // capture at the graph's own rate
+
+    std::uint32_t                sample_rate {kGraphRate};
+    std::uint32_t                channels {1U};     // more than one is downmixed in-process
+    std::optional<std::uint32_t> select_channel {};  // analyze one channel instead of the average
+};
+
+// Latest tempo state of one stream
+struct BeatSnapshot {
+    float         bpm {0.0F};
+    float         confidence {0.0F};  // beat tracker confidence, 0 until it has locked on
+    float         phase {0.0F};       // fraction of the current beat elapsed when read, [0, 1)
+    std::uint64_t beats {0U};
+    std::uint64_t last_beat_ns {0U};  // CLOCK_MONOTONIC time of the last beat, 0 before any
+};
+
+// One capture stream of a detector
+struct StreamSpec {
+    std::string target {};  // node name or object.serial to capture from, empty = default source
+};
+
+/*
+ * Live beat detection on one or more PipeWire capture streams.
+ *
+ * Every stream added runs on the same mainloop and daemon connection and writes into the same
+ * event log; each has its own analysis state and statistics. Without any addStream() call a
+ * single stream is opened on the default source.
+ */
 class BeatDetector {
 public:
     static constexpr std::uint32_t kDefaultBufferSize = 512U;
+    static constexpr std::size_t   kMaxStreams        = 256U;
 
-    explicit BeatDetector(std::uint32_t buffer_size              = kDefaultBufferSize,
-                          bool          enable_logging           = true,
-                          bool          enable_performance_stats = true,
-                          bool          enable_pitch_detection   = false,
-                          bool          enable_visual_feedback   = true);
+    // Receives every beat/onset drained in one mainloop wakeup, for one stream at a time
+    using EventCallback = std::function<void(std::span<const Event>)>;
+
+    explicit BeatDetector(std::uint32_t         buffer_size              = kDefaultBufferSize,
+                          bool                  enable_logging           = true,
+                          bool                  enable_performance_stats = true,
+                          bool                  enable_pitch_detection   = false,
+                          bool                  enable_visual_feedback   = true,
+                          const CaptureOptions& capture                  = {});
     ~BeatDetector();
 
     BeatDetector(const BeatDetector&)                    = delete;
     auto operator=(const BeatDetector&) -> BeatDetector& = delete;
 
+    // Before initialize(); returns the stream's index, which tags its log records
+    [[nodiscard]] auto addStream(StreamSpec spec) -> std::expected<std::size_t, std::string>;
+
+    // Before initialize(): publish every stream's beat clock in the shm segment `name`, for
+    // other processes to read through ClockReader
+    [[nodiscard]] auto publishClock(std::string name) -> std::expected<void, std::string>;
+
     [[nodiscard]] auto initialize() -> std::expected<void, std::string>;
-    void               run();
-    void               stop() noexcept;
-    static void        signalHandler(int) noexcept;
+
+    // Invoked on the mainloop thread and must not throw. Set it before run() or from the
+    // mainloop itself.
+    void setEventCallback(EventCallback callback);
+
+    // Lock-free and wait-free for the detector; safe from any thread once initialized
+    [[nodiscard]] auto snapshot(std::size_t stream = 0U) const noexcept -> BeatSnapshot;
+    [[nodiscard]] auto streamCount() const noexcept -> std::size_t;
+
+    // Lock-free, from any thread once initialized
+    [[nodiscard]] auto health(std::size_t stream = 0U) const noexcept -> StreamHealth;
+
+    // initialize() routes SIGINT/SIGTERM into the mainloop, which then stops run(). stop() may
+    // be called from any thread; signalHandler() is async-signal safe.
+    void        run();
+    void        stop() noexcept;
+    static void signalHandler(int) noexcept;
 
 private:
     struct Impl;
@@ -0,0 +1,399 @@
+module;
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+module beat.detector;
+
+import :analysis;
+import audio.blocks;
+import audio.wav;
+import support.threadpool;
+
+namespace beat {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Files are streamed this many blocks at a time; consumed pages of the mapping are released
+// after every chunk and files that need decoding are converted into a reused scratch buffer
+constexpr std::size_t kChunkBlocks = 64U;
+
+// Segment-parallel analysis. Every segment but the first starts this far before its own range
+// and discards what it finds there, so its beat tracker has locked on by the time it reports.
+constexpr double kWarmupSeconds     = 20.0;
+constexpr double kMinSegmentSeconds = 120.0;  // shorter pieces would be mostly warm-up
+constexpr double kOnsetSeamSeconds  = 0.05;   // onsets closer than this across a seam are merged
+
+// Frames [first, end) are analyzed, events before `report_from` are dropped
+struct FrameRange {
+    std::uint64_t first {0U};
+    std::uint64_t end {0U};
+    std::uint64_t report_from {0U};
+};
+
+// Where analyzeRange() reads its samples: straight from memory when they are mono floats,
+// otherwise decoded out of the file chunk by chunk
+struct SampleSource {
+    std::span<const float>    in_place {};
+    const audio_wav::WavFile* wav {nullptr};  // also released behind the read position
+};
+
+struct RangeResult {
+    std::uint64_t total_beats {0U};
+    std::uint64_t total_onsets {0U};
+    double        bpm_sum {0.0};
+    float         final_bpm {0.0F};
+};
+
+auto analyzeRange(const SampleSource& source,
+                  Analyzer&           analyzer,
+                  const FrameRange&   range,
+                  std::uint32_t       buffer_size,
+                  const EventSink&    sink,
+                  OfflineScratch&     scratch) -> std::expected<RangeResult, std::string> {
+    RangeResult   result {};
+    float         last_bpm = 0.0F;
+    std::uint64_t frame    = range.first;
+
+    auto process_block = [&](std::span<const float> block) -> void {
+        const auto block_start = Clock::now();
+        const auto analysis    = analyzer.process(block);
+        const auto block_ms =
+            std::chrono::duration<double, std::milli>(Clock::now() - block_start).count();
+
+        // Warm-up beats still update the tempo so the first reported event carries one
+        if (analysis.is_beat) {
+            last_bpm = analyzer.bpm();
+        }
+
+        const bool reported = frame >= range.report_from;
+        if (reported && analysis.is_beat) {
+            ++result.total_beats;
+            result.bpm_sum += static_cast<double>(last_bpm);
+        }
+
+        if (reported && analysis.is_onset) {
+            ++result.total_onsets;
+        }
+
+        if (reported && (analysis.is_beat || analysis.is_onset) && sink) {
+            sink(Event {.is_beat      = analysis.is_beat,
+                        .is_onset     = analysis.is_onset,
+                        .bpm          = last_bpm,
+                        .pitch_hz     = analysis.pitch_hz,
+                        .process_ms   = block_ms,
+                        .frame        = frame,
+                        .beat_offset  = analysis.is_beat ? analysis.beat_offset : 0U,
+                        .timestamp_ns = static_cast<std::uint64_t>(
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                block_start.time_since_epoch())
+                                .count()),
+                        .stream       = 0U});
+        }
+
+        frame += block.size();
+    };
+
+    // The final partial block of the range never completes and is not analyzed
+    audio_blocks::BlockAccumulator<float> accumulator {buffer_size};
+
+    auto process_view = [&](const audio_blocks::BufferView<float>& view)
+        -> std::expected<void, audio_blocks::ViewError> {
+        accumulator.push(view.samples(), process_block);
+        return {};
+    };
+
+    const auto chunk_frames = static_cast<std::size_t>(buffer_size) * kChunkBlocks;
+
+    // Mono float files are analyzed straight out of the mapping
+    const auto in_place = source.in_place;
+    if (in_place.empty()) {
+        scratch.decode.resize(chunk_frames);
+    }
+
+    for (std::uint64_t first_frame = range.first; first_frame < range.end;) {
+        const auto wanted = static_cast<std::size_t>(
+            std::min<std::uint64_t>(chunk_frames, range.end - first_frame));
+
+        std::span<const float> chunk;
+        if (!in_place.empty()) {
+            chunk = in_place.subspan(static_cast<std::size_t>(first_frame), wanted);
+        } else {
+            const auto decode = std::span<float> {scratch.decode}.first(wanted);
+            chunk             = decode.first(source.wav->decodeMono(first_frame, decode));
+        }
+
+        if (chunk.empty()) {
+            break;
+        }
+
+        if (auto status = audio_blocks::makeBufferViewFromSpan(chunk, buffer_size)
+                              .and_then(process_view);
+            !status) {
+            return std::unexpected(std::string {audio_blocks::toString(status.error())});
+        }
+
+        // The accumulator keeps its own copy of any partial block
+        if (source.wav != nullptr) {
+            source.wav->release(first_frame, first_frame + chunk.size());
+        }
+        first_frame += chunk.size();
+    }
+
+    result.final_bpm = analyzer.bpm();
+    return result;
+}
+
+[[nodiscard]] auto createAnalyzer(std::uint32_t sample_rate, const OfflineOptions& options)
+    -> std::expected<Analyzer, std::string> {
+    return Analyzer::create(AnalysisConfig {.buffer_size   = options.buffer_size,
+                                            .fft_size      = options.buffer_size * 2,
+                                            .sample_rate   = sample_rate,
+                                            .pitch_enabled = options.pitch});
+}
+
+[[nodiscard]] auto fileSource(const audio_wav::WavFile& wav) noexcept -> SampleSource {
+    return SampleSource {.in_place = wav.monoF32(), .wav = &wav};
+}
+
+// Totals and timing of a finished analysis
+void finishReport(OfflineReport& report, const RangeResult& total, Clock::time_point start) {
+    report.elapsed_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    report.total_beats     = total.total_beats;
+    report.total_onsets    = total.total_onsets;
+    report.final_bpm       = total.final_bpm;
+    if (total.total_beats > 0U) {
+        report.average_bpm =
+            static_cast<float>(total.bpm_sum / static_cast<double>(total.total_beats));
+    }
+}
+
+// Segment boundaries on the block grid, so every segment sees the same blocks a sequential
+// pass would. A single segment means the file is not worth splitting.
+[[nodiscard]] auto planSegments(const audio_wav::WavFile& wav, const OfflineOptions& options)
+    -> std::vector<FrameRange> {
+    const auto frames = wav.frames();
+    const auto rate   = static_cast<double>(wav.sampleRate());
+    const auto align  = [block = options.buffer_size](std::uint64_t position) {
+        return position / block * block;
+    };
+
+    const auto min_segment = std::max<std::uint64_t>(
+        static_cast<std::uint64_t>(kMinSegmentSeconds * rate), 1U);
+    const auto warmup = align(static_cast<std::uint64_t>(kWarmupSeconds * rate));
+    const auto count  = std::clamp<std::uint64_t>(frames / min_segment, 1U, options.jobs);
+
+    std::vector<FrameRange> segments;
+    segments.reserve(static_cast<std::size_t>(count));
+    for (std::uint64_t index = 0U; index < count; ++index) {
+        const auto report_from = align(frames * index / count);
+        const auto end = index + 1U == count ? frames : align(frames * (index + 1U) / count);
+        segments.push_back(FrameRange {.first       = report_from - std::min(report_from, warmup),
+                                       .end         = end,
+                                       .report_from = report_from});
+    }
+
+    return segments;
+}
+
+struct SegmentOutput {
+    std::expected<RangeResult, std::string> result {std::unexpected(std::string {})};
+    std::vector<Event>                      events;
+};
+
+// Joins per-segment events into one stream. Each segment only reports its own range, but a
+// beat right at a seam can be found by both neighbours a few blocks apart; the later copy is
+// dropped when it falls within half a beat period of the last beat kept from the segment
+// before. Onsets get the same treatment with a fixed window.
+[[nodiscard]] auto stitchSegments(std::span<const SegmentOutput> outputs,
+                                  std::uint32_t                  sample_rate)
+    -> std::vector<Event> {
+    const auto rate         = static_cast<double>(sample_rate);
+    const auto onset_window = static_cast<std::uint64_t>(kOnsetSeamSeconds * rate);
+
+    struct Kept {
+        std::uint64_t frame;
+        float         bpm;
+        std::size_t   segment;
+    };
+
+    std::vector<Event>  merged;
+    std::optional<Kept> last_beat;
+    std::optional<Kept> last_onset;
+
+    for (std::size_t segment = 0U; segment < outputs.size(); ++segment) {
+        for (auto event : outputs[segment].events) {
+            if (event.is_beat && last_beat && last_beat->segment != segment
+                && last_beat->bpm > 0.0F) {
+                const auto half_period =
+                    static_cast<std::uint64_t>(30.0 * rate / static_cast<double>(last_beat->bpm));
+                event.is_beat = event.frame - last_beat->frame >= half_period;
+            }
+
+            if (event.is_onset && last_onset && last_onset->segment != segment) {
+                event.is_onset = event.frame - last_onset->frame >= onset_window;
+            }
+
+            if (event.is_beat) {
+                last_beat = Kept {.frame = event.frame, .bpm = event.bpm, .segment = segment};
+            }
+            if (event.is_onset) {
+                last_onset = Kept {.frame = event.frame, .bpm = event.bpm, .segment = segment};
+            }
+            if (event.is_beat || event.is_onset) {
+                merged.push_back(event);
+            }
+        }
+    }
+
+    return merged;
+}
+
+}  // namespace
+
+auto analyzeFile(const std::filesystem::path& path,
+                 const OfflineOptions&        options,
+                 const EventSink&             sink) -> std::expected<OfflineReport, std::string> {
+    OfflineScratch scratch {};
+    return analyzeFile(path, options, sink, scratch);
+}
+
+auto analyzeFile(const std::filesystem::path& path,
+                 const OfflineOptions&        options,
+                 const EventSink&             sink,
+                 OfflineScratch&              scratch)
+    -> std::expected<OfflineReport, std::string> {
+    const auto wav = audio_wav::WavFile::open(path);
+    if (!wav) {
+        return std::unexpected(
+            std::format("{}: {}", path.string(), audio_wav::toString(wav.error())));
+    }
+
+    OfflineReport report {.sample_rate   = wav->sampleRate(),
+                          .channels      = wav->channels(),
+                          .frames        = wav->frames(),
+                          .audio_seconds = wav->durationSeconds()};
+
+    const auto start    = Clock::now();
+    const auto segments = options.jobs > 1U
+                            ? planSegments(*wav, options)
+                            : std::vector<FrameRange> {FrameRange {.end = wav->frames()}};
+
+    RangeResult total {};
+
+    if (segments.size() == 1U) {
+        auto analyzer = createAnalyzer(wav->sampleRate(), options);
+        if (!analyzer) {
+            return std::unexpected(analyzer.error());
+        }
+
+        auto result = analyzeRange(
+            fileSource(*wav), *analyzer, segments.front(), options.buffer_size, sink, scratch);
+        if (!result) {
+            return std::unexpected(result.error());
+        }
+        total = *result;
+    } else {
+        std::vector<SegmentOutput> outputs(segments.size());
+
+        {
+            threadpool::Pool            pool {segments.size()};
+            std::vector<OfflineScratch> worker_scratch(pool.workerCount());
+
+            for (std::size_t index = 0U; index < segments.size(); ++index) {
+                pool.submit([&, index](std::size_t worker) {
+                    auto& output = outputs[index];
+                    try {
+                        auto analyzer = createAnalyzer(wav->sampleRate(), options);
+                        if (!analyzer) {
+                            output.result = std::unexpected(analyzer.error());
+                            return;
+                        }
+
+                        output.result = analyzeRange(
+                            fileSource(*wav),
+                            *analyzer,
+                            segments[index],
+                            options.buffer_size,
+                            [&output](const Event& event) { output.events.push_back(event); },
+                            worker_scratch[worker]);
+                    } catch (const std::exception& exception) {
+                        output.result = std::unexpected(std::string {exception.what()});
+                    }
+                });
+            }
+        }
+
+        for (const auto& output : outputs) {
+            if (!output.result) {
+                return std::unexpected(output.result.error());
+            }
+        }
+
+        for (const auto& event : stitchSegments(outputs, wav->sampleRate())) {
+            if (event.is_beat) {
+                ++total.total_beats;
+                total.bpm_sum += static_cast<double>(event.bpm);
+            }
+            if (event.is_onset) {
+                ++total.total_onsets;
+            }
+            if (sink) {
+                sink(event);
+            }
+        }
+        total.final_bpm = outputs.back().result->final_bpm;
+    }
+
+    report.segments = segments.size();
+    finishReport(report, total, start);
+    return report;
+}
+
+auto analyzeSamples(std::span<const float> samples,
+                    std::uint32_t          sample_rate,
+                    const OfflineOptions&  options,
+                    const EventSink&       sink) -> std::expected<OfflineReport, std::string> {
+    if (sample_rate == 0U) {
+        return std::unexpected(std::string {"sample rate must be > 0"});
+    }
+
+    OfflineReport report {.sample_rate   = sample_rate,
+                          .channels      = 1U,
+                          .frames        = samples.size(),
+                          .audio_seconds = static_cast<double>(samples.size())
+                                         / static_cast<double>(sample_rate)};
+
+    const auto start    = Clock::now();
+    auto       analyzer = createAnalyzer(sample_rate, options);
+    if (!analyzer) {
+        return std::unexpected(analyzer.error());
+    }
+
+    OfflineScratch scratch {};
+    const auto     total = analyzeRange(SampleSource {.in_place = samples},
+                                        *analyzer,
+                                        FrameRange {.end = samples.size()},
+                                        options.buffer_size,
+                                        sink,
+                                        scratch);
+    if (!total) {
+        return std::unexpected(total.error());
+    }
+
+    finishReport(report, *total, start);
+    return report;
+}
+
+}  // namespace beat
@@ -0,0 +1,78 @@
+module;
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+export module beat.detector:offline;
+
+import :analysis;
+
+export namespace beat {
+
+struct OfflineOptions {
+    static constexpr std::uint32_t kDefaultBufferSize = 512U;
+
+    std::uint32_t buffer_size {kDefaultBufferSize};
+    bool          pitch {false};
+
+    // More than one splits long files into overlapping segments analyzed concurrently and
+    // stitched back together; results then differ slightly from a sequential pass at the seams
+    std::size_t jobs {1U};
+};
+
+struct OfflineReport {
+    std::uint32_t sample_rate {0U};
+    std::uint32_t channels {0U};
+    std::uint64_t frames {0U};
+    std::uint64_t total_beats {0U};
+    std::uint64_t total_onsets {0U};
+    float         average_bpm {0.0F};  // mean of the tempo reported at every beat
+    float         final_bpm {0.0F};    // tempo estimate at the end of the file
+    double        audio_seconds {0.0};
+    double        elapsed_seconds {0.0};
+    std::size_t   segments {1U};  // pieces the file was analyzed in
+
+    // How many times faster than real time the file was analyzed
+    [[nodiscard]] auto speedup() const noexcept -> double {
+        return elapsed_seconds > 0.0 ? audio_seconds / elapsed_seconds : 0.0;
+    }
+};
+
+using EventSink = std::function<void(const Event&)>;
+
+// Analyzes a WAV file as fast as the CPU allows, through the same block pipeline as the
+// real-time path, calling `sink` for every beat/onset event in stream order
+[[nodiscard]] auto analyzeFile(const std::filesystem::path& path,
+                               const OfflineOptions&        options,
+                               const EventSink&             sink = {})
+    -> std::expected<OfflineReport, std::string>;
+
+// The same for mono samples already in memory, e.g. generated test signals. Always a single
+// sequential pass: `options.jobs` is ignored.
+[[nodiscard]] auto analyzeSamples(std::span<const float> samples,
+                                  std::uint32_t          sample_rate,
+                                  const OfflineOptions&  options,
+                                  const EventSink&       sink = {})
+    -> std::expected<OfflineReport, std::string>;
+
+}  // namespace beat
+
+namespace beat {
+
+// Buffers reused across files when one thread analyzes many of them
+struct OfflineScratch {
+    std::vector<float> decode;
+};
+
+[[nodiscard]] auto analyzeFile(const std::filesystem::path& path,
+                               const OfflineOptions&        options,
+                               const EventSink&             sink,
+                               OfflineScratch&              scratch)
+    -> std::expected<OfflineReport, std::string>;
+
+}  // namespace beat
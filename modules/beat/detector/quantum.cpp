@@ -0,0 +1,341 @@
+module;
+#include <spa/buffer/buffer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <numeric>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <utility>
+
+module beat.detector;
+
+import :analysis;
+import :clock;
+import :quantum;
+import audio.blocks;
+import support.counter;
+import support.trace;
+
+namespace beat {
+
+namespace {
+
+constexpr std::int64_t kNanosPerSecond = 1'000'000'000;
+
+[[nodiscard]] auto steadyNowNs() noexcept -> std::int64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+[[nodiscard]] auto downmixFor(const QuantumConfig& quantum_config) noexcept
+    -> audio_blocks::DownmixWeights {
+    return quantum_config.select_channel
+               ? audio_blocks::DownmixWeights::select(quantum_config.channels,
+                                                      *quantum_config.select_channel)
+               : audio_blocks::DownmixWeights::average(quantum_config.channels);
+}
+
+}  // namespace
+
+QuantumProcessor::QuantumProcessor(const QuantumConfig& quantum_config)
+    : config_(quantum_config)
+    , downmix_(downmixFor(quantum_config))
+    , accumulator_(quantum_config.buffer_size) {}
+
+auto QuantumProcessor::makeAnalyzer(std::uint32_t sample_rate) const
+    -> std::expected<Analyzer, std::string> {
+    return Analyzer::create(AnalysisConfig {.buffer_size   = config_.buffer_size,
+                                            .fft_size      = config_.fft_size,
+                                            .sample_rate   = sample_rate,
+                                            .pitch_enabled = config_.pitch_enabled});
+}
+
+auto QuantumProcessor::start(std::uint32_t sample_rate) -> std::expected<void, std::string> {
+    auto next = makeAnalyzer(sample_rate);
+    if (!next) {
+        return std::unexpected(next.error());
+    }
+
+    analyzer_.emplace(std::move(*next));
+    return {};
+}
+
+auto QuantumProcessor::averageBpm() const noexcept -> float {
+    const auto& state_bpm = bpm_;
+
+    if (state_bpm.count == 0) {
+        return 0.0F;
+    }
+
+    const auto bpm_value_view = std::views::iota(std::size_t {0}, state_bpm.count)
+                                | std::views::transform([&](std::size_t value_index) {
+                                      const std::size_t capacity = kBPMCapacity;
+                                      const std::size_t first_index =
+                                          (state_bpm.head + capacity - state_bpm.count) % capacity;
+                                      return state_bpm.values[(first_index + value_index)
+                                                              % capacity];
+                                  });
+
+    const float total_bpm   = std::accumulate(bpm_value_view.begin(), bpm_value_view.end(), 0.0F);
+    const float average_bpm = total_bpm / static_cast<float>(state_bpm.count);
+    return average_bpm;
+}
+
+auto QuantumProcessor::healthSnapshot() const noexcept -> StreamHealth {
+    constexpr auto read = [](const std::atomic<std::uint64_t>& counter) {
+        return counter.load(std::memory_order_relaxed);
+    };
+    constexpr auto to_load = [](std::uint64_t scaled) {
+        return static_cast<float>(scaled) / static_cast<float>(kLoadScale);
+    };
+
+    StreamHealth snapshot {.quanta         = read(health_.quanta),
+                           .xruns          = read(health_.xruns),
+                           .late_callbacks = read(health_.late_callbacks),
+                           .overruns       = read(health_.overruns),
+                           .dropped_events = events_.dropped(),
+                           .dsp_load       = to_load(read(health_.load)),
+                           .dsp_load_max   = to_load(read(health_.load_max))};
+
+    std::ranges::transform(health_.rejected, snapshot.rejected_buffers.begin(), read);
+    return snapshot;
+}
+
+void QuantumProcessor::checkGraphTiming(std::int64_t now_ns,
+                                        std::int64_t delay_ns,
+                                        std::int64_t callback_ns) noexcept {
+    const auto previous = std::exchange(
+        previous_cycle_, GraphCycle {.now_ns = now_ns, .delay_ns = delay_ns, .frames = 0U});
+    if (previous.frames == 0U) {
+        return;
+    }
+
+    // The previous quantum's length stands in for this one's, which is not known yet
+    const auto period_ns = static_cast<std::int64_t>(previous.frames) * kNanosPerSecond
+                         / static_cast<std::int64_t>(analyzer_->config().sample_rate);
+
+    // A cycle that started more than half a period late means at least one was skipped; a
+    // capture delay that moved by a whole period means the device dropped or repeated data.
+    // Inferred from the graph times alone, so a fake stream can drive this too; the driver's
+    // own count (spa_io_clock::xrun, via io_changed(SPA_IO_Position)) is not consulted.
+    const auto cycle_ns = now_ns - previous.now_ns;
+    if (cycle_ns > period_ns + (period_ns / 2)
+        || std::abs(delay_ns - previous.delay_ns) >= period_ns) {
+        counter::bump(health_.xruns);
+        report(RtDiagnostic::Kind::Xrun);
+    }
+
+    if (callback_ns - now_ns > period_ns / 2) {
+        counter::bump(health_.late_callbacks);
+    }
+}
+
+void QuantumProcessor::process(const spa_buffer*        buffer,
+                               std::optional<GraphTime> graph_time) noexcept {
+    using Clock = std::chrono::steady_clock;
+
+    const auto quantum_start = Clock::now();
+    if (!analyzer_) {
+        return;  // no format negotiated yet
+    }
+
+    if (graph_time) {
+        checkGraphTiming(graph_time->now_ns,
+                         graph_time->delay_ns,
+                         std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             quantum_start.time_since_epoch())
+                             .count());
+    } else {
+        previous_cycle_ = {};  // no baseline to compare the next cycle against
+    }
+
+    if (buffer == nullptr || buffer->datas[0].data == nullptr
+        || buffer->datas[0].chunk == nullptr) {
+        return;
+    }
+
+    const bool stats_enabled = config_.stats_enabled;
+    bool       pushed_events = false;
+
+    // Events are timestamped from the quantum's graph clock anchor by their sample offset, so
+    // they are exact to the sample and cost no clock read of their own
+    const auto sample_rate   = static_cast<std::int64_t>(analyzer_->config().sample_rate);
+    const auto anchor_frame  = static_cast<std::int64_t>(frames_captured_);
+    const auto anchor_ns =
+        graph_time ? graph_time->now_ns - graph_time->delay_ns : steadyNowNs();
+    auto       frame_time_ns = [&](std::uint64_t frame) -> std::uint64_t {
+        const auto offset = static_cast<std::int64_t>(frame) - anchor_frame;
+        return static_cast<std::uint64_t>(anchor_ns + (offset * kNanosPerSecond / sample_rate));
+    };
+
+    const auto stream_tag = static_cast<std::uint32_t>(config_.stream);
+
+    auto process_block = [&](std::span<const float> block) -> void {
+        const trace::Scope probe {"analyze"};
+        const auto         block_start = Clock::now();
+        const auto [is_beat, is_onset, pitch_hz, beat_offset] = analyzer_->process(block);
+        const auto block_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - block_start)
+                .count();
+
+        if (stats_enabled) {
+            block_times_ns_.record(static_cast<std::uint64_t>(block_ns));
+        }
+
+        const auto block_frame  = frames_processed_;
+        frames_processed_      += block.size();
+
+        const auto event_ns = frame_time_ns(block_frame + (is_beat ? beat_offset : 0U));
+
+        // Real-time only bookkeeping
+        bool  produced_event = false;
+        float bpm_now        = last_bpm_;
+
+        if (is_beat) {
+            ++total_beats_;
+
+            bpm_now   = analyzer_->bpm();
+            last_bpm_ = bpm_now;
+
+            bpm_.values[bpm_.head] = bpm_now;
+            bpm_.head              = (bpm_.head + 1) % kBPMCapacity;
+            bpm_.count             = std::min(bpm_.count + 1, kBPMCapacity);
+
+            const auto confidence = analyzer_->confidence();
+
+            tempo_.store(TempoState {.bpm          = bpm_now,
+                                     .confidence   = confidence,
+                                     .beats        = total_beats_,
+                                     .last_beat_ns = event_ns});
+
+            if (clock_ != nullptr) {
+                const auto period_ns =
+                    bpm_now > 0.0F ? static_cast<std::uint64_t>(60e9 / static_cast<double>(bpm_now))
+                                   : 0U;
+                clock_->publish(config_.stream,
+                                ClockRecord {.bpm          = bpm_now,
+                                             .confidence   = confidence,
+                                             .beats        = total_beats_,
+                                             .last_beat_ns = event_ns,
+                                             .next_beat_ns =
+                                                 period_ns > 0U ? event_ns + period_ns : 0U});
+            }
+
+            produced_event = true;
+        }
+
+        if (is_onset) {
+            ++total_onsets_;
+            produced_event = true;
+        }
+
+        if (produced_event) {
+            // Push to the SPSC ring, dropped (and counted) if full
+            const trace::Scope queue_probe {"queue"};
+            if (!events_.tryPush(Event {.is_beat      = is_beat,
+                                        .is_onset     = is_onset,
+                                        .bpm          = bpm_now,
+                                        .pitch_hz     = pitch_hz,
+                                        .process_ms   = static_cast<double>(block_ns) / 1e6,
+                                        .frame        = block_frame,
+                                        .beat_offset  = is_beat ? beat_offset : 0U,
+                                        .timestamp_ns = event_ns,
+                                        .stream       = stream_tag})) {
+                report(RtDiagnostic::Kind::EventDropped);
+            }
+            pushed_events = true;
+        }
+    };
+
+    // After every sample of the quantum has been fed to the analyzer
+    auto finish_quantum = [&](std::size_t frames) -> void {
+        frames_captured_ += frames;
+
+        // One wakeup for the whole quantum instead of one per event
+        if (pushed_events) {
+            wake();
+        }
+
+        if (frames == 0U) {
+            return;
+        }
+
+        counter::bump(health_.quanta);
+        if (previous_cycle_.now_ns != 0) {
+            previous_cycle_.frames = frames;
+        }
+
+        const auto elapsed_ns = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - quantum_start)
+                .count());
+        const auto budget_ns = (frames * 1'000'000'000U) / analyzer_->config().sample_rate;
+        const auto load      = (elapsed_ns * kLoadScale) / std::max<std::uint64_t>(budget_ns, 1U);
+
+        health_.load.store(load, std::memory_order_relaxed);
+        if (load > health_.load_max.load(std::memory_order_relaxed)) {
+            health_.load_max.store(load, std::memory_order_relaxed);
+        }
+        if (load > kLoadScale) {
+            counter::bump(health_.overruns);
+        }
+        if (stats_enabled) {
+            quantum_load_.record(load);
+        }
+    };
+
+    auto process_view = [&](const audio_blocks::BufferView<float>& view)
+        -> std::expected<void, audio_blocks::ViewError> {
+        // Stitch the tail of the previous quantum onto this one so every
+        // sample reaches aubio exactly once
+        accumulator_.push(view.samples(), process_block);
+        finish_quantum(view.size());
+        return {};  // success
+    };
+
+    auto process_pcm = [&](const audio_blocks::PcmView& view)
+        -> std::expected<void, audio_blocks::ViewError> {
+        // Converted and downmixed straight into the block being assembled
+        accumulator_.fill(
+            view.frames(),
+            [&](std::span<float> destination, std::size_t first) {
+                const trace::Scope probe {"convert"};
+                audio_blocks::convertDownmix(view, first, downmix_, destination);
+            },
+            process_block);
+        finish_quantum(view.frames());
+        return {};  // success
+    };
+
+    auto report_rejected =
+        [&](audio_blocks::ViewError error) -> std::expected<void, audio_blocks::ViewError> {
+        counter::bump(health_.rejected[static_cast<std::size_t>(error)]);
+        report(RtDiagnostic::Kind::BufferRejected, static_cast<std::uint8_t>(error));
+        return std::unexpected {error};
+    };
+
+    // Build a single bounded view over the whole SPA buffer. Mono host
+    // order float is analyzed in place, anything else converted on the way
+    const auto spec_now = sample_spec_.load(std::memory_order_acquire);
+    if (config_.channels == 1U && spec_now.isNativeF32()) {
+        [[maybe_unused]] auto view_res =
+            audio_blocks::makeBufferViewFromSpaMonoF32(buffer, config_.buffer_size)
+                .and_then(process_view)
+                .or_else(report_rejected);
+    } else {
+        [[maybe_unused]] auto view_res =
+            audio_blocks::makePcmViewFromSpa(buffer, spec_now, config_.channels)
+                .and_then(process_pcm)
+                .or_else(report_rejected);
+    }
+}
+
+}  // namespace beat
@@ -0,0 +1,285 @@
+module;
+#include <spa/buffer/buffer.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string>
+
+export module beat.detector:quantum;
+
+import :analysis;
+import :clock;
+import audio.blocks;
+import support.latency;
+import support.seqlock;
+import support.spsc;
+
+export namespace beat {
+
+// Health counters of one stream, every field readable while it runs
+struct StreamHealth {
+    std::uint64_t quanta {0U};
+    std::uint64_t xruns {0U};           // graph cycles skipped, or capture delay jumps
+    std::uint64_t late_callbacks {0U};  // .process entered over half a quantum into the cycle
+    std::uint64_t overruns {0U};        // quanta that took longer to process than to play
+    std::uint64_t dropped_events {0U};  // beats/onsets lost to a full event ring
+
+    // Buffers that could not be viewed, indexed by audio_blocks::ViewError
+    std::array<std::uint64_t, audio_blocks::kViewErrorCount> rejected_buffers {};
+
+    float dsp_load {0.0F};      // processing time / audio duration of the last quantum
+    float dsp_load_max {0.0F};  // worst quantum so far
+
+    [[nodiscard]] auto rejectedBuffers() const noexcept -> std::uint64_t {
+        std::uint64_t total = 0U;
+        for (const auto count : rejected_buffers) {
+            total += count;
+        }
+        return total;
+    }
+};
+
+// Graph cycle start (CLOCK_MONOTONIC) and capture latency of one quantum
+struct GraphTime {
+    std::int64_t now_ns {0};
+    std::int64_t delay_ns {0};
+};
+
+struct QuantumConfig {
+    std::uint32_t                buffer_size;    // analysis block, in samples
+    std::uint32_t                fft_size;
+    std::uint32_t                channels {1U};  // interleaved input, downmixed when > 1
+    std::optional<std::uint32_t> select_channel {};  // analyze one channel instead of the average
+    std::size_t                  stream {0U};        // tags events and picks the clock slot
+    bool                         pitch_enabled {false};
+    bool                         stats_enabled {false};
+};
+
+}  // namespace beat
+
+namespace beat {
+
+// Something the RT thread needs reported. It only queues these; the mainloop prints them.
+struct RtDiagnostic {
+    enum class Kind : std::uint8_t { BufferRejected, EventDropped, Xrun };
+
+    static constexpr std::size_t kKinds = 3U;
+    static constexpr std::size_t kCodes = 8U;
+
+    Kind         kind;
+    std::uint8_t code {0U};  // the ViewError of a rejected buffer
+};
+
+}  // namespace beat
+
+export namespace beat {
+
+/*
+ * Everything one capture stream does in a quantum, with PipeWire left outside: view or convert
+ * the buffer, run the analyzer over every complete block, timestamp and queue the events,
+ * publish the tempo, and keep the health counters.
+ *
+ * The live detector calls process() from its .process callback with the buffer it dequeued and
+ * the stream's timing; anything else that can produce a spa_buffer and a graph time (a test
+ * driver, a replay) runs the exact same code. Results leave through `events` and
+ * `diagnostics`, and the wake hook tells the consumer there is something to drain.
+ */
+class QuantumProcessor {
+public:
+    // RT side, at most once per quantum; the host wakes whatever drains the rings
+    using WakeFn = void (*)(void* context) noexcept;
+
+    static constexpr std::size_t   kEventCap      = 1024U;
+    static constexpr std::size_t   kDiagnosticCap = 64U;
+    static constexpr std::size_t   kBPMCapacity   = 10U;
+    static constexpr std::uint64_t kLoadScale     = 10'000U;
+
+    using EventRing      = spsc::Ring<Event, kEventCap>;
+    using DiagnosticRing = spsc::Ring<RtDiagnostic, kDiagnosticCap>;
+
+    // Published by the RT thread on every beat, read from any thread
+    struct TempoState {
+        float         bpm {0.0F};
+        float         confidence {0.0F};
+        std::uint64_t beats {0U};
+        std::uint64_t last_beat_ns {0U};
+    };
+
+    explicit QuantumProcessor(const QuantumConfig& quantum_config);
+
+    QuantumProcessor(const QuantumProcessor&)                    = delete;
+    auto operator=(const QuantumProcessor&) -> QuantumProcessor& = delete;
+    QuantumProcessor(QuantumProcessor&&)                         = delete;
+    auto operator=(QuantumProcessor&&) -> QuantumProcessor&      = delete;
+    ~QuantumProcessor()                                          = default;
+
+    // Not on the RT thread: aubio allocates
+    [[nodiscard]] auto makeAnalyzer(std::uint32_t sample_rate) const
+        -> std::expected<Analyzer, std::string>;
+
+    // Before the first quantum: analyze at `sample_rate` from now on
+    [[nodiscard]] auto start(std::uint32_t sample_rate) -> std::expected<void, std::string>;
+
+    void setWake(WakeFn wake, void* context) noexcept {
+        wake_         = wake;
+        wake_context_ = context;
+    }
+
+    // Shared-memory beat clock to publish every beat into. Before the first quantum.
+    void setClock(ClockWriter* clock) noexcept {
+        clock_ = clock;
+    }
+
+    // Negotiated sample layout, set by the host before quanta in that layout arrive
+    void setSampleSpec(audio_blocks::SampleSpec spec) noexcept {
+        sample_spec_.store(spec, std::memory_order_release);
+    }
+
+    // RT: one quantum. `graph_time` is the cycle the buffer belongs to, when the caller knows
+    // it; without it events are stamped from the steady clock on entry.
+    void process(const spa_buffer* buffer, std::optional<GraphTime> graph_time) noexcept;
+
+    // RT, start of a quantum: swap `next` in as the live analyzer, leaving the old one in
+    // `next` for the caller to free elsewhere
+    void replaceAnalyzer(std::optional<Analyzer>& next) noexcept {
+        analyzer_.swap(next);
+        accumulator_.reset();  // the carried-over samples belong to the old rate
+        frames_processed_ = frames_captured_;
+    }
+
+    // Consumer side of the rings, one thread at a time
+    [[nodiscard]] auto events() noexcept -> EventRing& {
+        return events_;
+    }
+
+    [[nodiscard]] auto diagnostics() noexcept -> DiagnosticRing& {
+        return diagnostics_;
+    }
+
+    [[nodiscard]] auto config() const noexcept -> const QuantumConfig& {
+        return config_;
+    }
+
+    [[nodiscard]] auto tempo() const noexcept -> TempoState {
+        return tempo_.load();
+    }
+
+    [[nodiscard]] auto healthSnapshot() const noexcept -> StreamHealth;
+    [[nodiscard]] auto averageBpm() const noexcept -> float;
+
+    // Only read once the RT thread is done with the stream
+    [[nodiscard]] auto totalBeats() const noexcept -> std::uint64_t {
+        return total_beats_;
+    }
+
+    [[nodiscard]] auto totalOnsets() const noexcept -> std::uint64_t {
+        return total_onsets_;
+    }
+
+    // Recorded only when stats are enabled. Quantum load is the time spent in process()
+    // relative to the audio duration of the quantum, in units of 1/kLoadScale.
+    [[nodiscard]] auto blockTimes() const noexcept -> const latency::Histogram& {
+        return block_times_ns_;
+    }
+
+    [[nodiscard]] auto quantumLoad() const noexcept -> const latency::Histogram& {
+        return quantum_load_;
+    }
+
+private:
+    // Written by the RT thread (single writer, see counter::bump()), readable from any thread
+    struct HealthCounters {
+        std::atomic<std::uint64_t> quanta {0U};
+        std::atomic<std::uint64_t> xruns {0U};
+        std::atomic<std::uint64_t> late_callbacks {0U};
+        std::atomic<std::uint64_t> overruns {0U};
+        std::atomic<std::uint64_t> load {0U};  // last quantum, in units of 1/kLoadScale
+        std::atomic<std::uint64_t> load_max {0U};
+
+        std::array<std::atomic<std::uint64_t>, audio_blocks::kViewErrorCount> rejected {};
+    };
+
+    // The previous cycle as seen through the graph time, for xrun detection
+    struct GraphCycle {
+        std::int64_t  now_ns {0};
+        std::int64_t  delay_ns {0};
+        std::uint64_t frames {0U};
+    };
+
+    struct BPMBuffer {
+        std::array<float, kBPMCapacity> values {};
+        std::size_t                     count {0U};
+        std::size_t                     head {0U};
+    };
+
+    // RT side, start of every quantum: xruns and late wakeups from the graph's timing
+    void checkGraphTiming(std::int64_t now_ns, std::int64_t delay_ns, std::int64_t callback_ns)
+        noexcept;
+
+    // RT side: queue a diagnostic for the consumer
+    void report(RtDiagnostic::Kind kind, std::uint8_t code = 0U) noexcept {
+        if (diagnostics_.tryPush(RtDiagnostic {.kind = kind, .code = code})) {
+            wake();
+        }
+    }
+
+    void wake() const noexcept {
+        if (wake_ != nullptr) {
+            wake_(wake_context_);
+        }
+    }
+
+    const QuantumConfig config_;
+
+    // Only touched by the RT thread once streaming
+    std::optional<Analyzer> analyzer_;
+
+    // Folds interleaved captures down to mono when `config_.channels` > 1
+    const audio_blocks::DownmixWeights downmix_;
+
+    std::atomic<audio_blocks::SampleSpec> sample_spec_ {audio_blocks::SampleSpec {}};
+
+    // Carries the partial block at the end of each quantum over into the next one
+    audio_blocks::BlockAccumulator<float> accumulator_;
+
+    ClockWriter* clock_ {nullptr};
+
+    // RT only
+    std::uint64_t total_beats_ {0}, total_onsets_ {0};
+    std::uint64_t frames_processed_ {0};  // fed to the analyzer
+    std::uint64_t frames_captured_ {0};   // handed to process()
+    float         last_bpm_ {0.F};
+    GraphCycle    previous_cycle_ {};
+    BPMBuffer     bpm_ {};
+
+    latency::Histogram block_times_ns_;
+    latency::Histogram quantum_load_;
+
+    HealthCounters health_;
+
+    /*
+     * Real-time (RT) -> consumer communication
+     *
+     * Lock-free single-producer/single-consumer (SPSC) queues carrying analysis results and
+     * diagnostics off the RT thread. `spsc::Ring` keeps the producer and consumer indices on
+     * separate cache lines and never lets the RT side touch the read index: when the consumer
+     * falls behind, new entries are dropped and counted rather than overwriting slots it may be
+     * reading. No locks, which are unsafe in real-time contexts.
+     */
+    EventRing events_;
+
+    // Nothing on the RT thread can block on stdio. A full ring drops them, the health counters
+    // still have the totals.
+    DiagnosticRing diagnostics_;
+
+    seqlock::SeqLock<TempoState> tempo_;
+
+    WakeFn wake_ {nullptr};
+    void*  wake_context_ {nullptr};
+};
+
+}  // namespace beat
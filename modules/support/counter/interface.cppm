@@ -0,0 +1,20 @@
+module;
+#include <atomic>
+#include <cstdint>
+
+export module support.counter;
+
+export namespace counter {
+
+/*
+ * Adds to a statistics counter that only one thread ever writes, such as the RT thread.
+ *
+ * A relaxed load/store pair rather than fetch_add: nothing else writes the counter, so the
+ * locked read-modify-write would buy nothing on the RT path. Readers on any thread still see
+ * whole values, just possibly a little stale.
+ */
+inline void bump(std::atomic<std::uint64_t>& value, std::uint64_t amount = 1U) noexcept {
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+}  // namespace counter
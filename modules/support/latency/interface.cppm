@@ -0,0 +1,137 @@
+module;
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+export module support.latency;
+
+import support.counter;
+
+export namespace latency {
+
+/*
+ * Fixed-memory log-linear histogram (HdrHistogram style) for latency samples.
+ *
+ * Values below 2^kSubBucketBits get an exact bucket each; above that every power of two is
+ * split into 2^kSubBucketBits linear sub-buckets, giving ~6% worst-case relative error over
+ * the whole range with a few KiB of storage and no allocation.
+ *
+ * `record()` is meant for a single writer (e.g. the RT thread) and is wait-free; any thread
+ * may read concurrently and sees a slightly stale but usable snapshot.
+ */
+class Histogram {
+public:
+    static constexpr std::uint32_t kSubBucketBits = 4U;
+    static constexpr std::uint32_t kSubBuckets    = 1U << kSubBucketBits;
+    static constexpr std::uint32_t kMaxValueBits  = 40U;  // ~18 minutes when recording ns
+    static constexpr std::size_t   kBucketCount =
+        static_cast<std::size_t>(kMaxValueBits - kSubBucketBits + 2U) * kSubBuckets;
+
+    void record(std::uint64_t value) noexcept {
+        counter::bump(counts_[bucketFor(value)]);
+        counter::bump(total_);
+        counter::bump(sum_, value);
+
+        if (value > max_.load(std::memory_order_relaxed)) {
+            max_.store(value, std::memory_order_relaxed);
+        }
+        if (value < min_.load(std::memory_order_relaxed)) {
+            min_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    [[nodiscard]] auto count() const noexcept -> std::uint64_t {
+        return total_.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto max() const noexcept -> std::uint64_t {
+        return max_.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto min() const noexcept -> std::uint64_t {
+        return count() > 0U ? min_.load(std::memory_order_relaxed) : 0U;
+    }
+
+    [[nodiscard]] auto mean() const noexcept -> double {
+        const auto samples = count();
+        return samples > 0U ? static_cast<double>(sum_.load(std::memory_order_relaxed))
+                                  / static_cast<double>(samples)
+                            : 0.0;
+    }
+
+    // Smallest recorded value v such that at least `fraction` of all samples are <= v,
+    // reported as the upper edge of its bucket (never above the true max)
+    [[nodiscard]] auto percentile(double fraction) const noexcept -> std::uint64_t {
+        const auto samples = count();
+        if (samples == 0U) {
+            return 0U;
+        }
+
+        // Rounded up, so p50 of 3 samples is the 2nd and p99.9 of 100 the max. The slack keeps
+        // products like 0.07 * 100 = 7.000000000000001 from reaching one rank too far.
+        const auto rank = std::max<std::uint64_t>(
+            1U,
+            static_cast<std::uint64_t>(std::ceil(
+                (std::clamp(fraction, 0.0, 1.0) * static_cast<double>(samples)) - 1e-9)));
+
+        std::uint64_t seen = 0U;
+        for (std::size_t index = 0U; index < kBucketCount; ++index) {
+            seen += counts_[index].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return std::min(bucketUpperBound(index), max());
+            }
+        }
+
+        return max();
+    }
+
+    // Only call while no writer is active
+    void reset() noexcept {
+        for (auto& bucket : counts_) {
+            bucket.store(0U, std::memory_order_relaxed);
+        }
+        total_.store(0U, std::memory_order_relaxed);
+        sum_.store(0U, std::memory_order_relaxed);
+        max_.store(0U, std::memory_order_relaxed);
+        min_.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] static constexpr auto bucketFor(std::uint64_t value) noexcept -> std::size_t {
+        if (value < kSubBuckets) {
+            return static_cast<std::size_t>(value);
+        }
+
+        const auto exponent =
+            std::min(static_cast<std::uint32_t>(std::bit_width(value)) - 1U, kMaxValueBits);
+        const auto shift = exponent - kSubBucketBits;
+        const auto sub   = std::min<std::uint64_t>(value >> shift, (kSubBuckets * 2U) - 1U)
+                         & (kSubBuckets - 1U);
+
+        return (static_cast<std::size_t>(shift + 1U) * kSubBuckets) + static_cast<std::size_t>(sub);
+    }
+
+    [[nodiscard]] static constexpr auto bucketUpperBound(std::size_t index) noexcept
+        -> std::uint64_t {
+        if (index < kSubBuckets) {
+            return index;
+        }
+
+        const auto shift = static_cast<std::uint32_t>(index / kSubBuckets) - 1U;
+        const auto sub   = static_cast<std::uint64_t>(index % kSubBuckets);
+        return ((kSubBuckets + sub + 1U) << shift) - 1U;
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, kBucketCount> counts_ {};
+    std::atomic<std::uint64_t>                           total_ {0U};
+    std::atomic<std::uint64_t>                           sum_ {0U};
+    std::atomic<std::uint64_t>                           max_ {0U};
+    std::atomic<std::uint64_t> min_ {std::numeric_limits<std::uint64_t>::max()};
+};
+
+}  // namespace latency
@@ -0,0 +1,83 @@
+module;
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+export module support.seqlock;
+
+export namespace seqlock {
+
+/*
+ * Single-writer sequence lock for small trivially copyable records.
+ *
+ * - `store()` is wait-free, so the writer can be the RT thread; readers never block it.
+ * - `load()` retries while a store is in flight and returns a consistent copy.
+ * - The payload lives in relaxed 64-bit atomics rather than a plain T, so torn reads that get
+ *   discarded are not data races. All members are address-free lock-free atomics, which also
+ *   makes the layout usable across processes in shared memory.
+ */
+template <typename T>
+    requires(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>)
+class SeqLock {
+public:
+    using ValueType = T;
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+    // Writer only
+    void store(const ValueType& value) noexcept {
+        std::array<std::uint64_t, kWords> words {};
+        std::memcpy(words.data(), &value, sizeof(ValueType));
+
+        const auto sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1U, std::memory_order_relaxed);  // odd: store in progress
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (std::size_t index = 0U; index < kWords; ++index) {
+            words_[index].store(words[index], std::memory_order_relaxed);
+        }
+
+        sequence_.store(sequence + 2U, std::memory_order_release);
+    }
+
+    // Any thread
+    [[nodiscard]] auto load() const noexcept -> ValueType {
+        std::array<std::uint64_t, kWords> words {};
+
+        for (;;) {
+            const auto before = sequence_.load(std::memory_order_acquire);
+            if ((before & 1U) != 0U) {
+                continue;
+            }
+
+            for (std::size_t index = 0U; index < kWords; ++index) {
+                words[index] = words_[index].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+        }
+
+        ValueType value {};
+        std::memcpy(&value, words.data(), sizeof(ValueType));
+        return value;
+    }
+
+    // Completed stores so far, times two
+    [[nodiscard]] auto sequence() const noexcept -> std::uint64_t {
+        return sequence_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr std::size_t kWords = (sizeof(ValueType) + 7U) / 8U;
+
+    std::atomic<std::uint64_t>                     sequence_ {0U};
+    std::array<std::atomic<std::uint64_t>, kWords> words_ {};
+};
+
+}  // namespace seqlock
@@ -0,0 +1,105 @@
+module;
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+
+export module support.spsc;
+
+import support.counter;
+
+export namespace spsc {
+
+// Fixed rather than std::hardware_destructive_interference_size, which is not ABI-stable
+inline constexpr std::size_t kCacheLineSize = 64U;
+
+/*
+ * Bounded lock-free single-producer/single-consumer ring.
+ *
+ * - Capacity is a power of two and indices run freely, slots are addressed with a mask.
+ * - Each side owns a cache line holding its index plus a cached copy of the other side's
+ *   index, so the shared line is only pulled across cores when the cache looks full/empty.
+ * - The producer never writes the consumer's index: when the ring is full the new element is
+ *   dropped and counted instead, which keeps the queue correct under overload.
+ */
+template <typename T, std::size_t Capacity>
+    requires(std::is_trivially_copyable_v<T> && std::has_single_bit(Capacity))
+class Ring {
+public:
+    using ValueType = T;
+
+    static constexpr std::size_t kCapacity = Capacity;
+
+    // Producer only. Returns false (and counts a drop) when the ring is full.
+    auto tryPush(const ValueType& value) noexcept -> bool {
+        const auto head = producer_.head.load(std::memory_order_relaxed);
+
+        if (head - producer_.cached_tail == kCapacity) {
+            producer_.cached_tail = consumer_.tail.load(std::memory_order_acquire);
+            if (head - producer_.cached_tail == kCapacity) {
+                counter::bump(producer_.dropped);
+                return false;
+            }
+        }
+
+        slots_[head & kMask] = value;
+        producer_.head.store(head + 1U, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only
+    [[nodiscard]] auto tryPop() noexcept -> std::optional<ValueType> {
+        const auto tail = consumer_.tail.load(std::memory_order_relaxed);
+
+        if (tail == consumer_.cached_head) {
+            consumer_.cached_head = producer_.head.load(std::memory_order_acquire);
+            if (tail == consumer_.cached_head) {
+                return std::nullopt;
+            }
+        }
+
+        const ValueType value = slots_[tail & kMask];
+        consumer_.tail.store(tail + 1U, std::memory_order_release);
+        return value;
+    }
+
+    // Approximate from any thread, exact from either endpoint's own point of view
+    [[nodiscard]] auto empty() const noexcept -> bool {
+        return size() == 0U;
+    }
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t {
+        const auto tail = consumer_.tail.load(std::memory_order_acquire);
+        const auto head = producer_.head.load(std::memory_order_acquire);
+        return head - tail;
+    }
+
+    // Elements rejected because the ring was full, readable from any thread
+    [[nodiscard]] auto dropped() const noexcept -> std::uint64_t {
+        return producer_.dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr std::size_t kMask = kCapacity - 1U;
+
+    struct alignas(kCacheLineSize) ProducerSide {
+        std::atomic<std::size_t>   head {0U};
+        std::size_t                cached_tail {0U};
+        std::atomic<std::uint64_t> dropped {0U};
+    };
+
+    struct alignas(kCacheLineSize) ConsumerSide {
+        std::atomic<std::size_t> tail {0U};
+        std::size_t              cached_head {0U};
+    };
+
+    ProducerSide producer_ {};
+    ConsumerSide consumer_ {};
+
+    alignas(kCacheLineSize) std::array<ValueType, kCapacity> slots_ {};
+};
+
+}  // namespace spsc
@@ -0,0 +1,168 @@
+module;
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+export module support.threadpool;
+
+export namespace threadpool {
+
+/*
+ * Fixed-size work-stealing thread pool.
+ *
+ * - Every worker owns a deque behind its own mutex; submissions are spread round-robin.
+ * - A worker takes from the back of its own deque and, when that is empty, steals from the
+ *   front of the others, so a few long tasks never leave the remaining workers idle.
+ * - Tasks receive the index of the worker running them, for per-worker scratch state.
+ *
+ * Tasks must not throw.
+ */
+class Pool {
+public:
+    using Task = std::move_only_function<void(std::size_t worker)>;
+
+    // 0 workers means one per hardware thread
+    explicit Pool(std::size_t workers = 0U) {
+        if (workers == 0U) {
+            workers = std::max<std::size_t>(1U, std::thread::hardware_concurrency());
+        }
+
+        queues_.reserve(workers);
+        for (std::size_t index = 0U; index < workers; ++index) {
+            queues_.push_back(std::make_unique<Queue>());
+        }
+
+        workers_.reserve(workers);
+        for (std::size_t index = 0U; index < workers; ++index) {
+            workers_.emplace_back(
+                [this, index](const std::stop_token& stop_token) { run(stop_token, index); });
+        }
+    }
+
+    Pool(const Pool&)                    = delete;
+    auto operator=(const Pool&) -> Pool& = delete;
+    Pool(Pool&&)                         = delete;
+    auto operator=(Pool&&) -> Pool&      = delete;
+
+    // Finishes every submitted task before joining the workers
+    ~Pool() {
+        wait();
+        for (auto& worker : workers_) {
+            worker.request_stop();
+        }
+        workers_.clear();
+    }
+
+    [[nodiscard]] auto workerCount() const noexcept -> std::size_t {
+        return queues_.size();
+    }
+
+    void submit(Task task) {
+        pending_.fetch_add(1U, std::memory_order_relaxed);
+
+        // Counted before the push so `queued_` never underflows; under the sleep mutex so a
+        // worker that just found nothing to do cannot miss the wakeup
+        {
+            const std::scoped_lock lock {sleep_mutex_};
+            queued_.fetch_add(1U, std::memory_order_relaxed);
+        }
+
+        const auto slot  = next_queue_.fetch_add(1U, std::memory_order_relaxed) % workerCount();
+        auto&      queue = *queues_[slot];
+        {
+            const std::scoped_lock lock {queue.mutex};
+            queue.tasks.push_back(std::move(task));
+        }
+        wake_.notify_one();
+    }
+
+    // Blocks until every task submitted so far has finished
+    void wait() const noexcept {
+        for (auto pending = pending_.load(std::memory_order_acquire); pending != 0U;
+             pending      = pending_.load(std::memory_order_acquire)) {
+            pending_.wait(pending, std::memory_order_acquire);
+        }
+    }
+
+private:
+    struct Queue {
+        std::mutex       mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(const std::stop_token& stop_token, std::size_t index) {
+        while (!stop_token.stop_requested()) {
+            auto task = takeOwn(index);
+            if (!task) {
+                task = steal(index);
+            }
+
+            if (!task) {
+                std::unique_lock lock {sleep_mutex_};
+                wake_.wait(lock, stop_token, [this] {
+                    return queued_.load(std::memory_order_relaxed) > 0U;
+                });
+                continue;
+            }
+
+            (*task)(index);
+
+            if (pending_.fetch_sub(1U, std::memory_order_acq_rel) == 1U) {
+                pending_.notify_all();
+            }
+        }
+    }
+
+    auto takeOwn(std::size_t index) -> std::optional<Task> {
+        auto&                  queue = *queues_[index];
+        const std::scoped_lock lock {queue.mutex};
+        if (queue.tasks.empty()) {
+            return std::nullopt;
+        }
+
+        auto task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        queued_.fetch_sub(1U, std::memory_order_relaxed);
+        return task;
+    }
+
+    auto steal(std::size_t thief) -> std::optional<Task> {
+        for (std::size_t offset = 1U; offset < workerCount(); ++offset) {
+            auto&            queue = *queues_[(thief + offset) % workerCount()];
+            std::unique_lock lock {queue.mutex, std::try_to_lock};
+            if (!lock.owns_lock() || queue.tasks.empty()) {
+                continue;
+            }
+
+            auto task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            queued_.fetch_sub(1U, std::memory_order_relaxed);
+            return task;
+        }
+
+        return std::nullopt;
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::atomic<std::size_t>            next_queue_ {0U};
+    std::atomic<std::size_t>            queued_ {0U};   // sitting in a deque
+    std::atomic<std::size_t>            pending_ {0U};  // submitted and not yet finished
+
+    std::mutex                  sleep_mutex_;
+    std::condition_variable_any wake_;
+
+    // Last member: the workers are joined before anything they use goes away
+    std::vector<std::jthread> workers_;
+};
+
+}  // namespace threadpool
@@ -0,0 +1,221 @@
+module;
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+export module support.trace;
+
+export namespace trace {
+
+// Set by the ENABLE_TRACE build option. Off, every probe compiles to nothing.
+#if defined(BEAT_TRACE) && BEAT_TRACE
+inline constexpr bool kEnabled = true;
+#else
+inline constexpr bool kEnabled = false;
+#endif
+
+inline constexpr std::size_t kMaxThreads       = 16U;
+inline constexpr std::size_t kRecordsPerThread = std::size_t {1} << 15U;  // 768 KiB per thread
+
+}  // namespace trace
+
+namespace trace::detail {
+
+[[nodiscard]] inline auto nowNs() noexcept -> std::uint64_t {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count());
+}
+
+/*
+ * One thread's probes, overwriting the oldest once full. Fields are relaxed atomics so the
+ * exporter can read while the owner keeps writing; slots it may have raced with are skipped.
+ */
+struct ThreadBuffer {
+    struct Record {
+        std::atomic<std::uintptr_t> name {0U};  // string literal
+        std::atomic<std::uint64_t>  begin_ns {0U};
+        std::atomic<std::uint64_t>  end_ns {0U};
+    };
+
+    std::atomic<std::uint64_t> head {0U};
+    pid_t                      tid {0};
+    std::unique_ptr<Record[]>  records {std::make_unique<Record[]>(kRecordsPerThread)};
+
+    void push(const char* name, std::uint64_t begin_ns, std::uint64_t end_ns) noexcept {
+        const auto index  = head.load(std::memory_order_relaxed);
+        auto&      record = records[index & (kRecordsPerThread - 1U)];
+        record.name.store(reinterpret_cast<std::uintptr_t>(name), std::memory_order_relaxed);
+        record.begin_ns.store(begin_ns, std::memory_order_relaxed);
+        record.end_ns.store(end_ns, std::memory_order_relaxed);
+        head.store(index + 1U, std::memory_order_release);
+    }
+};
+
+// Buffers are allocated up front by start(); threads claim one on their first probe
+struct Registry {
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::atomic<std::size_t>                   claimed {0U};
+    std::atomic_bool                           running {false};
+};
+
+inline auto registry() noexcept -> Registry& {
+    static Registry instance;
+    return instance;
+}
+
+// Claimed without allocating, so the first probe on an RT thread is as cheap as the rest.
+// A thread that arrives after every buffer is taken goes untraced.
+inline auto threadBuffer() noexcept -> ThreadBuffer* {
+    thread_local ThreadBuffer* buffer  = nullptr;
+    thread_local bool          claimed = false;
+
+    if (!claimed) {
+        auto& state = registry();
+        if (!state.running.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        claimed          = true;
+        const auto index = state.claimed.fetch_add(1U, std::memory_order_relaxed);
+        if (index < state.buffers.size()) {
+            buffer      = state.buffers[index].get();
+            buffer->tid = ::gettid();
+        }
+    }
+
+    return buffer;
+}
+
+}  // namespace trace::detail
+
+export namespace trace {
+
+// Allocates the per-thread buffers; call once before the threads to trace start probing
+inline void start() {
+    if constexpr (kEnabled) {
+        auto& state = detail::registry();
+        if (state.running.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        state.buffers.reserve(kMaxThreads);
+        for (std::size_t index = 0U; index < kMaxThreads; ++index) {
+            state.buffers.push_back(std::make_unique<detail::ThreadBuffer>());
+        }
+        state.running.store(true, std::memory_order_release);
+    }
+}
+
+/*
+ * Times the enclosing scope as one complete event named `name`, which must be a string
+ * literal. Two clock reads and three relaxed stores when tracing is compiled in, an empty
+ * object otherwise.
+ */
+#if defined(BEAT_TRACE) && BEAT_TRACE
+class Scope {
+public:
+    explicit Scope(const char* name) noexcept
+        : name_(name)
+        , begin_ns_(detail::nowNs()) {}
+
+    ~Scope() {
+        if (auto* buffer = detail::threadBuffer(); buffer != nullptr) {
+            buffer->push(name_, begin_ns_, detail::nowNs());
+        }
+    }
+
+    Scope(const Scope&)                    = delete;
+    auto operator=(const Scope&) -> Scope& = delete;
+    Scope(Scope&&)                         = delete;
+    auto operator=(Scope&&) -> Scope&      = delete;
+
+private:
+    const char*   name_;
+    std::uint64_t begin_ns_;
+};
+#else
+class Scope {
+public:
+    explicit Scope(const char* /*name*/) noexcept {}
+    ~Scope() = default;
+
+    Scope(const Scope&)                    = delete;
+    auto operator=(const Scope&) -> Scope& = delete;
+    Scope(Scope&&)                         = delete;
+    auto operator=(Scope&&) -> Scope&      = delete;
+};
+#endif
+
+/*
+ * Writes everything still held in the thread buffers as Chrome trace JSON (chrome://tracing,
+ * ui.perfetto.dev). Safe while the traced threads keep running. Returns the number of events
+ * written.
+ */
+inline auto exportChrome(const std::filesystem::path& path)
+    -> std::expected<std::size_t, std::string> {
+    if constexpr (!kEnabled) {
+        return std::unexpected(std::string {"built without ENABLE_TRACE"});
+    } else {
+        std::ofstream out {path, std::ios::out | std::ios::trunc};
+        if (!out) {
+            return std::unexpected(std::format("{}: failed to open", path.string()));
+        }
+
+        auto&       state   = detail::registry();
+        const auto  claimed = std::min(state.claimed.load(std::memory_order_acquire),
+                                      state.buffers.size());
+        const auto  pid     = ::getpid();
+        std::size_t written = 0U;
+
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        for (const auto& buffer : std::span {state.buffers}.first(claimed)) {
+            const auto head  = buffer->head.load(std::memory_order_acquire);
+            const auto first = head - std::min<std::uint64_t>(head, kRecordsPerThread);
+
+            for (auto index = first; index < head; ++index) {
+                const auto& record = buffer->records[index & (kRecordsPerThread - 1U)];
+                const auto  name   = record.name.load(std::memory_order_relaxed);
+                const auto  begin  = record.begin_ns.load(std::memory_order_relaxed);
+                const auto  end    = record.end_ns.load(std::memory_order_relaxed);
+
+                // Overwritten while we were reading it
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (buffer->head.load(std::memory_order_relaxed) - index >= kRecordsPerThread) {
+                    continue;
+                }
+
+                out << std::format("{}{{\"name\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},"
+                                   "\"pid\":{},\"tid\":{}}}",
+                                   written == 0U ? "" : ",",
+                                   reinterpret_cast<const char*>(name),
+                                   static_cast<double>(begin) / 1e3,
+                                   static_cast<double>(end - begin) / 1e3,
+                                   pid,
+                                   buffer->tid);
+                ++written;
+            }
+        }
+        out << "]}\n";
+
+        if (!out.flush()) {
+            return std::unexpected(std::format("{}: write failed", path.string()));
+        }
+        return written;
+    }
+}
+
+}  // namespace trace
@@ -7,6 +7,7 @@ import beat.detector;
 #include <expected>
 #include <filesystem>
 #include <format>
+#include <fstream>
 #include <iostream>
 #include <limits>
 #include <print>
@@ -33,7 +34,7 @@ void printUsage(std::string_view argv0) {
     std::println(" {} [buffer_size] [options]\n", argv0);
     std::println("Options:");
 
-    constexpr int col_width = 16;
+    constexpr int col_width = 22;
     auto          print_opt  = [&](std::string_view option, std::string_view description) -> void {
         std::println("  {:<{}}{}", option, col_width, description);
     };
@@ -42,6 +43,16 @@ void printUsage(std::string_view argv0) {
     print_opt("--no-stats", "Disable performance statistics");
     print_opt("--pitch", "Enable pitch detection");
     print_opt("--no-visual", "Disable visual feedback");
+    print_opt("--rate <hz>", "Capture sample rate (default: the graph's rate, no resampling)");
+    print_opt("--channels <n>", "Capture n interleaved channels and downmix them in-process");
+    print_opt("--select-channel <i>", "Analyze only channel i (0-based) of a multichannel capture");
+    print_opt("--target <node>", "Capture from a node name or serial; repeat for more streams");
+    print_opt("--shm <name>", "Publish the beat clock in shared memory (/dev/shm/<name>)");
+    print_opt("--file <path>", "Analyze a WAV file offline instead of live capture");
+    print_opt("--convert-log <path>", "Convert a binary event log to CSV next to it");
+    print_opt("--batch <dir>", "Analyze every WAV file below a directory, one CSV row each");
+    print_opt("--jobs <n>", "Threads for --batch (default: all cores) or --file");
+    print_opt("--output <path>", "Write --batch results to a file instead of stdout");
     print_opt("--help, -h", "Show this help");
     std::println("");
 }
@@ -89,10 +100,24 @@ struct Options {
     bool          stats {true};
     bool          pitch {false};
     bool          visual {true};
+
+    beat::CaptureOptions     capture {};  // live stream rate and channel layout
+    std::vector<std::string> targets {};  // one live stream each, the default source when empty
+    std::string              shm_name {};  // shared-memory beat clock, off when empty
+
+    std::filesystem::path input_file {};  // offline mode when set
+    std::filesystem::path convert_log {};  // convert a binary log and exit when set
+    std::filesystem::path batch_dir {};    // batch mode when set
+    std::filesystem::path output {};       // batch results, stdout when empty
+    std::uint32_t         jobs {0U};       // 0 = one per hardware thread
 };
 
 constexpr std::uint32_t kMinBufferSize = 64U;
 constexpr std::uint32_t kMaxBufferSize = 8192U;
+constexpr std::uint32_t kMaxJobs       = 1024U;
+constexpr std::uint32_t kMinSampleRate = 8000U;
+constexpr std::uint32_t kMaxSampleRate = 384000U;
+constexpr std::uint32_t kMaxChannels   = 64U;  // SPA_AUDIO_MAX_CHANNELS
 
 struct ParseError {
     enum class Kind : std::uint8_t { Help, Invalid } kind {Kind::Invalid};
@@ -139,6 +164,135 @@ struct ParseError {
             continue;
         }
 
+        if (arg == "--file") {
+            if (i + 1U >= args.size()) {
+                return std::unexpected {
+                    ParseError {.kind = Invalid, .message = "--file requires a path"}};
+            }
+            options.input_file = args[++i];
+            continue;
+        }
+
+        if (arg == "--convert-log") {
+            if (i + 1U >= args.size()) {
+                return std::unexpected {
+                    ParseError {.kind = Invalid, .message = "--convert-log requires a path"}};
+            }
+            options.convert_log = args[++i];
+            continue;
+        }
+
+        if (arg == "--batch") {
+            if (i + 1U >= args.size()) {
+                return std::unexpected {
+                    ParseError {.kind = Invalid, .message = "--batch requires a directory"}};
+            }
+            options.batch_dir = args[++i];
+            continue;
+        }
+
+        if (arg == "--output") {
+            if (i + 1U >= args.size()) {
+                return std::unexpected {
+                    ParseError {.kind = Invalid, .message = "--output requires a path"}};
+            }
+            options.output = args[++i];
+            continue;
+        }
+
+        if (arg == "--rate") {
+            if (i + 1U >= args.size()) {
+                return std::unexpected {
+                    ParseError {.kind = Invalid, .message = "--rate requires a value in Hz"}};
+            }
+
+            auto [rate, parse_err] = detail::parseU32(args[++i]);
+            if (parse_err != nullptr || rate < kMinSampleRate || rate > kMaxSampleRate) {
+                return std::unexpected {ParseError {
+                    .kind    = Invalid,
+                    .message = std::format(
+                        "--rate must be an integer in [{}, {}]", kMinSampleRate, kMaxSampleRate)}};
+            }
+
+            options.capture.sample_rate = rate;
+            continue;
+        }
+
+        if (arg == "--channels") {
+            if (i + 1U >= args.size()) {
+                return std::unexpected {
+                    ParseError {.kind = Invalid, .message = "--channels requires a count"}};
+            }
+
+            auto [channels, parse_err] = detail::parseU32(args[++i]);
+            if (parse_err != nullptr || channels == 0U || channels > kMaxChannels) {
+                return std::unexpected {ParseError {
+                    .kind = Invalid,
+                    .message =
+                        std::format("--channels must be an integer in [1, {}]", kMaxChannels)}};
+            }
+
+            options.capture.channels = channels;
+            continue;
+        }
+
+        if (arg == "--select-channel") {
+            if (i + 1U >= args.size()) {
+                return std::unexpected {
+                    ParseError {.kind = Invalid, .message = "--select-channel requires an index"}};
+            }
+
+            auto [channel, parse_err] = detail::parseU32(args[++i]);
+            if (parse_err != nullptr) {
+                return std::unexpected {ParseError {
+                    .kind = Invalid, .message = "--select-channel must be a base-10 integer"}};
+            }
+
+            options.capture.select_channel = channel;
+            continue;
+        }
+
+        if (arg == "--target") {
+            if (i + 1U >= args.size() || args[i + 1U].empty()) {
+                return std::unexpected {
+                    ParseError {.kind = Invalid, .message = "--target requires a node"}};
+            }
+            if (options.targets.size() >= beat::BeatDetector::kMaxStreams) {
+                return std::unexpected {ParseError {
+                    .kind    = Invalid,
+                    .message = std::format("At most {} --target streams are supported",
+                                           beat::BeatDetector::kMaxStreams)}};
+            }
+            options.targets.emplace_back(args[++i]);
+            continue;
+        }
+
+        if (arg == "--shm") {
+            if (i + 1U >= args.size() || args[i + 1U].empty()) {
+                return std::unexpected {
+                    ParseError {.kind = Invalid, .message = "--shm requires a name"}};
+            }
+            options.shm_name = args[++i];
+            continue;
+        }
+
+        if (arg == "--jobs") {
+            if (i + 1U >= args.size()) {
+                return std::unexpected {
+                    ParseError {.kind = Invalid, .message = "--jobs requires a count"}};
+            }
+
+            auto [jobs, parse_err] = detail::parseU32(args[++i]);
+            if (parse_err != nullptr || jobs == 0U || jobs > kMaxJobs) {
+                return std::unexpected {ParseError {
+                    .kind    = Invalid,
+                    .message = std::format("--jobs must be an integer in [1, {}]", kMaxJobs)}};
+            }
+
+            options.jobs = jobs;
+            continue;
+        }
+
         // clang-format off
         if (arg == "--no-log")    { options.logging = false; continue; }
         if (arg == "--no-stats")  { options.stats   = false; continue; }
@@ -150,8 +304,133 @@ struct ParseError {
             ParseError {.kind = Invalid, .message = std::format("Unknown option '{}'", arg)}};
     }
 
+    if (options.capture.select_channel
+        && *options.capture.select_channel >= options.capture.channels) {
+        return std::unexpected {ParseError {
+            .kind    = ParseError::Kind::Invalid,
+            .message = std::format("--select-channel must be below --channels ({})",
+                                   options.capture.channels)}};
+    }
+
     return options;
 }
+
+[[nodiscard]] static auto runOffline(const Options& options) -> int {
+    const auto report = beat::analyzeFile(
+        options.input_file,
+        beat::OfflineOptions {.buffer_size = options.buffer_size,
+                              .pitch       = options.pitch,
+                              .jobs        = options.jobs == 0U ? 1U : options.jobs});
+
+    if (!report) {
+        std::println(std::cerr, "Analysis error: {}", report.error());
+        return 1;
+    }
+
+    std::println("Analyzed {}", options.input_file.string());
+    std::println("\tAudio: {:.1F} s @ {} Hz, {} channel(s)",
+                 report->audio_seconds,
+                 report->sample_rate,
+                 report->channels);
+    std::println("\tElapsed: {:.3F} s ({:.0F}x real time)",
+                 report->elapsed_seconds,
+                 report->speedup());
+    std::println("\tBeats: {}, onsets: {}", report->total_beats, report->total_onsets);
+    if (report->segments > 1U) {
+        std::println("\tAnalyzed as {} parallel segments", report->segments);
+    }
+    std::println("\tAverage BPM: {:.1F} (final estimate {:.1F})",
+                 report->average_bpm,
+                 report->final_bpm);
+    return 0;
+}
+
+// Quotes a CSV field, doubling embedded quotes
+[[nodiscard]] static auto csvField(std::string_view text) -> std::string {
+    std::string quoted {'"'};
+    for (const char character : text) {
+        if (character == '"') {
+            quoted += '"';
+        }
+        quoted += character;
+    }
+    quoted += '"';
+    return quoted;
+}
+
+[[nodiscard]] static auto runBatch(const Options& options) -> int {
+    std::ofstream file;
+    if (!options.output.empty()) {
+        file.open(options.output, std::ios::out | std::ios::trunc);
+        if (!file.is_open()) {
+            std::println(std::cerr, "Failed to open {}", options.output.string());
+            return 1;
+        }
+    }
+    std::ostream& out = file.is_open() ? static_cast<std::ostream&>(file) : std::cout;
+
+    std::println(out,
+                 "path,sample_rate,channels,duration_s,beats,onsets,average_bpm,final_bpm,"
+                 "elapsed_s,error");
+
+    const auto summary = beat::analyzeDirectory(
+        options.batch_dir,
+        beat::BatchOptions {
+            .analysis = beat::OfflineOptions {.buffer_size = options.buffer_size,
+                                              .pitch       = options.pitch},
+            .jobs     = options.jobs},
+        [&out](const beat::BatchResult& result) {
+            const auto path = csvField(result.path.string());
+            if (!result.report) {
+                std::println(out, "{},,,,,,,,,{}", path, csvField(result.report.error()));
+                return;
+            }
+
+            const auto& report = *result.report;
+            std::println(out,
+                         "{},{},{},{:.3F},{},{},{:.2F},{:.2F},{:.3F},",
+                         path,
+                         report.sample_rate,
+                         report.channels,
+                         report.audio_seconds,
+                         report.total_beats,
+                         report.total_onsets,
+                         report.average_bpm,
+                         report.final_bpm,
+                         report.elapsed_seconds);
+        });
+
+    if (!summary) {
+        std::println(std::cerr, "Batch error: {}", summary.error());
+        return 1;
+    }
+
+    // CSV may be on stdout, keep the summary out of it
+    std::println(std::cerr,
+                 "Analyzed {} file(s) ({} failed) with {} job(s) in {:.1F} s, {:.0F}x real time",
+                 summary->files,
+                 summary->failed,
+                 summary->jobs,
+                 summary->elapsed_seconds,
+                 summary->elapsed_seconds > 0.0
+                     ? summary->audio_seconds / summary->elapsed_seconds
+                     : 0.0);
+    return 0;
+}
+
+[[nodiscard]] static auto runConvertLog(const Options& options) -> int {
+    auto output = options.convert_log;
+    output.replace_extension(".csv");
+
+    const auto converted = beat::convertEventLog(options.convert_log, output);
+    if (!converted) {
+        std::println(std::cerr, "Conversion error: {}", converted.error());
+        return 1;
+    }
+
+    std::println("Wrote {} event(s) to {}", *converted, output.string());
+    return 0;
+}
 }  // namespace beat_detector
 
 auto main(int argc, char* argv[]) -> int {
@@ -181,7 +460,20 @@ auto main(int argc, char* argv[]) -> int {
 
     const beat_detector::Options& options = *parsed;
 
-    // Signal handlers provided by BeatDetector
+    if (!options.convert_log.empty()) {
+        return beat_detector::runConvertLog(options);
+    }
+
+    if (!options.batch_dir.empty()) {
+        return beat_detector::runBatch(options);
+    }
+
+    if (!options.input_file.empty()) {
+        return beat_detector::runOffline(options);
+    }
+
+    // Only until initialize(): from then on the detector's mainloop receives SIGINT/SIGTERM
+    // itself, and these just cover a Ctrl+C while it is still starting up
     std::signal(SIGINT, &BeatDetector::signalHandler);
     std::signal(SIGTERM, &BeatDetector::signalHandler);
 
@@ -189,7 +481,22 @@ auto main(int argc, char* argv[]) -> int {
                           options.logging,
                           options.stats,
                           options.pitch,
-                          options.visual);
+                          options.visual,
+                          options.capture);
+
+    for (const auto& target : options.targets) {
+        if (auto added = detector.addStream(beat::StreamSpec {.target = target}); !added) {
+            std::println(std::cerr, "Init error: {}", added.error());
+            return 1;
+        }
+    }
+
+    if (!options.shm_name.empty()) {
+        if (auto published = detector.publishClock(options.shm_name); !published) {
+            std::println(std::cerr, "Init error: {}", published.error());
+            return 1;
+        }
+    }
 
     if (auto is_ok = detector.initialize(); !is_ok) {
         std::println(std::cerr, "Init error: {}", is_ok.error());